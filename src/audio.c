@@ -12,465 +12,202 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
 #include <stdlib.h>
-#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <string.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
-#include <bsd/bsd.h>
-#include <errno.h>
-#include <alsa/asoundlib.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "ipnode.h"
 #include "audio.h"
+#include "audio_backend.h"
 
-#define roundup1k(n) (((n) + 0x3ff) & ~0x3ff)
+static const struct audio_backend_s *backend = &audio_alsa_backend;
 
 /*
- * FYI snd_pcm_t is a typedef of struct _snd_pcm
- * Which is located in pcm_local.h in dev package
- *
- * https://github.com/alsa-project/alsa-lib/blob/master/src/pcm/pcm_local.h
+ * Use the file backend if an input file was given,
+ * otherwise the ALSA device from the config file.
  */
-
-static struct
-{
-    snd_pcm_t *audio_in_handle;
-    snd_pcm_t *audio_out_handle;
-
-    uint8_t *inbuf_ptr;
-    uint8_t *outbuf_ptr;
-
-    int bytes_per_frame;
-    int inbuf_size_in_bytes;
-    int outbuf_size_in_bytes;
-    int inbuf_len;
-    int outbuf_len;
-    int inbuf_next;
-} adev;
-
-static struct audio_s *save_audio_config_p;
-static int channels;
-static int bits_per_sample;
-
-static int set_alsa_params(snd_pcm_t *, struct audio_s *, char *, char *);
-
 int audio_open(struct audio_s *pa)
 {
-    char audio_in_name[30];
-    char audio_out_name[30];
-
-    channels = 1; // real only
-    bits_per_sample = 16;
-
-    save_audio_config_p = pa;
-
-    memset(&adev, 0, sizeof(adev));
-
-    adev.audio_in_handle = NULL;
-    adev.audio_out_handle = NULL;
-
-    if (pa->defined == true)
+    if (pa->input_file[0] != '\0')
     {
-        /* If not specified, the device names should be "default". */
-
-        strlcpy(audio_in_name, pa->adevice_in, sizeof(audio_in_name));
-        strlcpy(audio_out_name, pa->adevice_out, sizeof(audio_out_name));
-
-        fprintf(stderr, "Audio device for both receive and transmit: %s\n", audio_in_name);
-
-        int err = snd_pcm_open(&(adev.audio_in_handle), audio_in_name, SND_PCM_STREAM_CAPTURE, 0);
-
-        if (err < 0)
-        {
-            return err;
-        }
-
-        adev.inbuf_size_in_bytes = set_alsa_params(adev.audio_in_handle, pa, audio_in_name, "input");
-
-        if (adev.inbuf_size_in_bytes <= 0)
-        {
-            return -1;
-        }
-
-        err = snd_pcm_open(&(adev.audio_out_handle), audio_out_name, SND_PCM_STREAM_PLAYBACK, 0);
-
-        if (err < 0)
-        {
-            return -1;
-        }
-
-        adev.outbuf_size_in_bytes = set_alsa_params(adev.audio_out_handle, pa, audio_out_name, "output");
-
-        if (adev.outbuf_size_in_bytes <= 0)
-        {
-            return -1;
-        }
-
-        adev.inbuf_ptr = (uint8_t *)calloc(adev.inbuf_size_in_bytes, sizeof(uint8_t));
-
-        if (adev.inbuf_ptr == NULL)
-            return -1;
-
-        adev.outbuf_ptr = (uint8_t *)calloc(adev.outbuf_size_in_bytes, sizeof(uint8_t));
-
-        if (adev.outbuf_ptr == NULL)
-            return -1;
-
-        adev.inbuf_len = 0;
-        adev.outbuf_len = 0;
-        adev.inbuf_next = 0;
-
-        audio_wait();
-
-        return 0;
+        backend = &audio_file_backend;
+        pa->defined = true;
     }
-
-    return -1;
-}
-
-static int set_alsa_params(snd_pcm_t *handle, struct audio_s *pa, char *devname, char *inout)
-{
-    snd_pcm_hw_params_t *hw_params;
-
-    int err = snd_pcm_hw_params_malloc(&hw_params);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not alloc hw param (alloc) structure.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    err = snd_pcm_hw_params_any(handle, hw_params);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not init hw param (any) structure.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    err = snd_pcm_hw_params_set_access(handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not set interleaved mode.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    err = snd_pcm_hw_params_set_format(handle, hw_params, SND_PCM_FORMAT_S16_LE);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not set sound format.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    err = snd_pcm_hw_params_set_channels(handle, hw_params, channels); // real only
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not set number of audio channels.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    /* Audio sample rate. */
-
-    unsigned int val = FS;
-
-    int dir = 0;
-
-    err = snd_pcm_hw_params_set_rate_near(handle, hw_params, &val, &dir);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Fatal: Could not set audio sample rate. %s ", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    if (val != (int)FS)
-    {
-        fprintf(stderr, "Fatal: Asked for %d samples/sec but got %d ", (int)FS, val);
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    int buf_size_in_bytes = roundup1k((val * (channels * bits_per_sample / 8) * ONE_BUF_TIME) / 1000);
-
-#if __arm__
-    /*
-     * RPi hack
-     *
-     * Reducing buffer size is fine for input
-     * but not so good for output
-     */
-    if (*inout == 'o')
-    {
-        buf_size_in_bytes = buf_size_in_bytes * 4;
-    }
-#endif
-
-    snd_pcm_uframes_t fpp = buf_size_in_bytes / (channels * bits_per_sample / 8); // stereo
-
-    dir = 0;
-
-    err = snd_pcm_hw_params_set_period_size_near(handle, hw_params, &fpp, &dir);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not set period size\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
-
-    err = snd_pcm_hw_params(handle, hw_params);
-
-    if (err < 0)
+    else
     {
-        fprintf(stderr, "Could not set hw params\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
+        backend = &audio_alsa_backend;
     }
 
-    /*
-     * Driver might not like our suggested period size
-     * and might have another idea
-     */
-    err = snd_pcm_hw_params_get_period_size(hw_params, &fpp, NULL);
-
-    if (err < 0)
-    {
-        fprintf(stderr, "Could not get audio period size.\n%s\n", snd_strerror(err));
-        fprintf(stderr, "for %s %s.\n", devname, inout);
-        return -1;
-    }
+    return backend->open(pa);
+}
 
-    snd_pcm_hw_params_free(hw_params);
+/*
+ * Used by the channel simulator, which
+ * supplies its own in-memory backend
+ */
+void audio_set_backend(const struct audio_backend_s *b)
+{
+    backend = b;
+}
 
-    /*
-     * A "frame" is one sample for all channels
-     *
-     * The read and write use units of frames, not bytes
-     */
-    adev.bytes_per_frame = snd_pcm_frames_to_bytes(handle, 1);
+const char *audio_backend_name()
+{
+    return backend->name;
+}
 
-    buf_size_in_bytes = fpp * adev.bytes_per_frame;
+/*
+ * False when the source can outrun the sample rate,
+ * so the receiver should wait rather than drop samples.
+ */
+bool audio_is_realtime()
+{
+    return backend->realtime;
+}
 
-    if (buf_size_in_bytes < 256 || buf_size_in_bytes > 32768)
-    {
-        buf_size_in_bytes = 2048;
-    }
+/*
+ * Called by demod
+ *
+ * Fill samples[] with exactly count frames as float.
+ * Returns count, or -1 if the audio input failed or ended.
+ */
+int audio_read(float samples[], int count)
+{
+    return backend->read(samples, count);
+}
 
-    return buf_size_in_bytes;
+/*
+ * Number of frames in one capture period
+ */
+int audio_period_frames()
+{
+    return backend->period_frames();
 }
 
 /*
- * Called by demod
+ * Called by modulate
  */
-int audio_get()
+void audio_write(const float samples[], int count)
 {
-    int err;
+    backend->write(samples, count);
+}
 
-    int retries = 0;
+void audio_flush()
+{
+    backend->flush();
+}
 
-    while (adev.inbuf_next >= adev.inbuf_len)
-    {
-        err = snd_pcm_readi(adev.audio_in_handle, adev.inbuf_ptr, adev.inbuf_size_in_bytes / adev.bytes_per_frame);
-
-        if (err > 0)
-        {
-            adev.inbuf_len = err * adev.bytes_per_frame; /* convert to number of bytes */
-            adev.inbuf_next = 0;
-        }
-        else if (err == 0)
-        {
-            /*
-             * Didn't expect this, but it's not a problem
-             * Wait a little while and try again
-             */
-            fprintf(stderr, "Audio input got zero bytes: %s\n", snd_strerror(err));
-            SLEEP_MS(10);
-
-            adev.inbuf_len = 0;
-            adev.inbuf_next = 0;
-        }
-        else
-        {
-            fprintf(stderr, "Audio input device error code %d: %s\n", err, snd_strerror(err));
-
-            if (err == (-EPIPE))
-            {
-                fprintf(stderr, "Most likely a slow CPU unable to keep up with the audio stream.\n");
-            }
-
-            /*
-             * Try to recover a few times and eventually give up
-             */
-            if (++retries > 10)
-            {
-                adev.inbuf_len = 0;
-                adev.inbuf_next = 0;
-
-                return -1;
-            }
-
-            if (err == -EPIPE)
-            {
-                /*
-                 * EPIPE means overrun
-                 */
-                snd_pcm_recover(adev.audio_in_handle, err, 1);
-            }
-            else
-            {
-                SLEEP_MS(250);
-                snd_pcm_recover(adev.audio_in_handle, err, 1);
-            }
-        }
-    }
+void audio_wait()
+{
+    backend->wait();
+}
 
-    if (adev.inbuf_next < adev.inbuf_len)
-        return adev.inbuf_ptr[adev.inbuf_next++];
-    else
-        return 0;
+void audio_close()
+{
+    backend->close();
 }
 
 /*
- * Called externally by tx.c
- * but also internally
+ * Convert S16 PCM to float in the range -1.0 to +1.0
+ *
+ * SSE2 is always there on x86-64 and NEON on ARMv8,
+ * so these are picked at compile time.
  */
-void audio_flush()
+void audio_s16_to_float(const int16_t *in, float *out, int count)
 {
-    snd_pcm_status_t *status;
-
-    snd_pcm_status_alloca(&status);
+    int i = 0;
 
-    int k = snd_pcm_status(adev.audio_out_handle, status);
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
 
-    if (k != 0)
+    for (; i <= (count - 8); i += 8)
     {
-        fprintf(stderr, "Audio output get status error.\n%s\n", snd_strerror(k));
-    }
+        __m128i x = _mm_loadu_si128((const __m128i *)&in[i]);
 
-    if ((k = snd_pcm_status_get_state(status)) != SND_PCM_STATE_RUNNING)
-    {
-        k = snd_pcm_prepare(adev.audio_out_handle);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16); // sign extend
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
 
-        if (k != 0)
-        {
-            fprintf(stderr, "Audio output start error.\n%s\n", snd_strerror(k));
-        }
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
     }
+#elif defined(__ARM_NEON)
+    for (; i <= (count - 8); i += 8)
+    {
+        int16x8_t x = vld1q_s16(&in[i]);
 
-    uint8_t *psound = adev.outbuf_ptr;
-    int retries = 10;
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
 
-    while (retries-- > 0)
-    {
-        k = snd_pcm_writei(adev.audio_out_handle, psound, adev.outbuf_len / adev.bytes_per_frame);
-
-        if (k == -EPIPE)
-        {
-            fprintf(stderr, "Audio output data underrun.\n");
-            snd_pcm_recover(adev.audio_out_handle, k, 1);
-        }
-        else if (k == -ESTRPIPE)
-        {
-            fprintf(stderr, "Driver suspended, recovering\n");
-            snd_pcm_recover(adev.audio_out_handle, k, 1);
-        }
-        else if (k == -EBADFD)
-        {
-            k = snd_pcm_prepare(adev.audio_out_handle);
-
-            if (k < 0)
-            {
-                fprintf(stderr, "Error preparing after bad state: %s\n", snd_strerror(k));
-            }
-        }
-        else if (k < 0)
-        {
-            fprintf(stderr, "Audio write error: %s\n", snd_strerror(k));
-
-            k = snd_pcm_prepare(adev.audio_out_handle);
-
-            if (k < 0)
-            {
-                fprintf(stderr, "Error preparing after error: %s\n", snd_strerror(k));
-            }
-        }
-        else if (k != adev.outbuf_len / adev.bytes_per_frame)
-        {
-            fprintf(stderr, "Audio write took %d frames rather than %d.\n", k, adev.outbuf_len / adev.bytes_per_frame);
-
-            // Go around again with the rest of it
-
-            psound += k * adev.bytes_per_frame;
-            adev.outbuf_len -= k * adev.bytes_per_frame;
-        }
-        else
-        {
-            // Success!
-            adev.outbuf_len = 0;
-            return;
-        }
+        vst1q_f32(&out[i], vmulq_n_f32(lo, 1.0f / 32768.0f));
+        vst1q_f32(&out[i + 4], vmulq_n_f32(hi, 1.0f / 32768.0f));
     }
+#endif
 
-    fprintf(stderr, "Audio write error retry count exceeded.\n");
-
-    adev.outbuf_len = 0;
+    for (; i < count; i++)
+    {
+        out[i] = (float)in[i] / 32768.0f;
+    }
 }
 
 /*
- * Called by modulate
+ * Convert float to S16 PCM, saturating at full scale
+ *
+ * Filter overshoot past +/- 1.0 is clipped
+ * instead of wrapping around.
  */
-void audio_put(uint8_t c)
+void audio_float_to_s16(const float *in, int16_t *out, int count)
 {
-    adev.outbuf_ptr[adev.outbuf_len++] = c;
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 upper = _mm_set1_ps(32767.0f);
+    const __m128 lower = _mm_set1_ps(-32768.0f);
 
-    if (adev.outbuf_len == adev.outbuf_size_in_bytes)
+    for (; i <= (count - 8); i += 8)
     {
-        audio_flush();
-    }
-}
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(&in[i]), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(&in[i + 4]), scale);
 
-void audio_wait()
-{
-    audio_flush();
-    snd_pcm_drain(adev.audio_out_handle);
-}
+        a = _mm_max_ps(_mm_min_ps(a, upper), lower); // keep the int32 convert in range
+        b = _mm_max_ps(_mm_min_ps(b, upper), lower);
 
-void audio_close()
-{
-    if (adev.audio_in_handle != NULL && adev.audio_out_handle != NULL)
+        __m128i x = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+
+        _mm_storeu_si128((__m128i *)&out[i], x);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    /*
+     * ARMv7 NEON can only truncate, so it takes the scalar
+     * loop and rounds to nearest like every other build
+     */
+    for (; i <= (count - 8); i += 8)
     {
-        audio_wait();
+        float32x4_t a = vmulq_n_f32(vld1q_f32(&in[i]), 32768.0f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(&in[i + 4]), 32768.0f);
 
-        snd_pcm_close(adev.audio_in_handle);
-        snd_pcm_close(adev.audio_out_handle);
+        int32x4_t ia = vcvtnq_s32_f32(a); // round to nearest, saturating
+        int32x4_t ib = vcvtnq_s32_f32(b);
 
-        adev.audio_in_handle = adev.audio_out_handle = NULL;
+        vst1q_s16(&out[i], vcombine_s16(vqmovn_s32(ia), vqmovn_s32(ib)));
+    }
+#endif
 
-        free(adev.inbuf_ptr);
-        free(adev.outbuf_ptr);
+    for (; i < count; i++)
+    {
+        float v = in[i] * 32768.0f;
 
-        adev.inbuf_size_in_bytes = 0;
-        adev.inbuf_ptr = NULL;
-        adev.inbuf_len = 0;
-        adev.inbuf_next = 0;
+        if (v > 32767.0f)
+            v = 32767.0f;
+        else if (v < -32768.0f)
+            v = -32768.0f;
 
-        adev.outbuf_size_in_bytes = 0;
-        adev.outbuf_ptr = NULL;
-        adev.outbuf_len = 0;
+        out[i] = (int16_t)lrintf(v);
     }
 }
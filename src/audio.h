@@ -35,6 +35,13 @@ extern "C"
 #define ICTYPE_TXINH 0 // Transmit Inhibit
 #define NUM_ICTYPES 1
 
+#define THTYPE_RX 0      // Demodulator (DSP)
+#define THTYPE_CAPTURE 1 // Soundcard capture
+#define THTYPE_TX 2      // Modulator and PTT
+#define THTYPE_KISS 3    // KISS pseudo terminal
+#define THTYPE_LINK 4    // AX.25 link layer (main)
+#define NUM_THTYPES 5
+
 #define MAX_GPIO_NAME_LEN 20
 
     struct ictrl_s
@@ -52,6 +59,13 @@ extern "C"
         char out_gpio_name[MAX_GPIO_NAME_LEN]; /// ASCII
     };
 
+    struct sched_s
+    {
+        int policy;   // SCHED_OTHER, SCHED_FIFO, or SCHED_RR
+        int priority; // realtime priority 1 - 99
+        int cpu;      // pin to this CPU, or -1
+    };
+
     struct audio_s
     {
         int dwait;
@@ -59,18 +73,27 @@ extern "C"
         int persist;
         int txdelay;
         int txtail;
+        int rxring; // capture ring depth in mS
         bool defined;
         bool fulldup;
+        bool mmap;
+        bool mlockall;
+        struct sched_s sched[NUM_THTYPES];
         struct octrl_s octrl[NUM_OCTYPES];
         struct ictrl_s ictrl[NUM_ICTYPES];
         char adevice_in[80];                    // ASCII
         char adevice_out[80];                   // ASCII
+        char input_file[80];                    // WAV/raw recording, - for stdin
+        char output_file[80];                   // WAV/raw transmit audio, - for stdout
         char mycall[AX25_MAX_ADDR_LEN];
     };
 
     int audio_open(struct audio_s *);
-    int audio_get(void);
-    void audio_put(uint8_t);
+    const char *audio_backend_name(void);
+    bool audio_is_realtime(void);
+    int audio_read(float *, int);
+    int audio_period_frames(void);
+    void audio_write(const float *, int);
     void audio_flush(void);
     void audio_wait(void);
     void audio_close(void);
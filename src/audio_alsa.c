@@ -0,0 +1,796 @@
+/*
+ * audio_alsa.c
+ *
+ * IP Node Project
+ *
+ * Based on the Dire Wolf program
+ * Copyright (C) 2011-2021 John Langner
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <math.h>
+#include <bsd/bsd.h>
+#include <errno.h>
+#include <alsa/asoundlib.h>
+
+#include "ipnode.h"
+#include "audio.h"
+#include "audio_backend.h"
+
+#define roundup1k(n) (((n) + 0x3ff) & ~0x3ff)
+
+/*
+ * FYI snd_pcm_t is a typedef of struct _snd_pcm
+ * Which is located in pcm_local.h in dev package
+ *
+ * https://github.com/alsa-project/alsa-lib/blob/master/src/pcm/pcm_local.h
+ */
+
+static struct
+{
+    snd_pcm_t *audio_in_handle;
+    snd_pcm_t *audio_out_handle;
+
+    uint8_t *inbuf_ptr;
+    uint8_t *outbuf_ptr;
+
+    int bytes_per_frame;
+    int inbuf_size_in_bytes;
+    int outbuf_size_in_bytes;
+    int inbuf_len;
+    int outbuf_len;
+    int inbuf_next;
+
+    bool in_mmap;    // capture reads the DMA ring directly
+    bool out_mmap;   // playback writes the DMA ring directly
+    int out_pending; // frames committed before playback started
+} adev;
+
+static struct audio_s *save_audio_config_p;
+static int channels;
+static int bits_per_sample;
+
+static int set_alsa_params(snd_pcm_t *, struct audio_s *, char *, char *, bool *);
+static void alsa_flush(void);
+static void alsa_wait(void);
+
+static int alsa_open(struct audio_s *pa)
+{
+    char audio_in_name[30];
+    char audio_out_name[30];
+
+    channels = 1; // real only
+    bits_per_sample = 16;
+
+    save_audio_config_p = pa;
+
+    memset(&adev, 0, sizeof(adev));
+
+    adev.audio_in_handle = NULL;
+    adev.audio_out_handle = NULL;
+
+    if (pa->defined == true)
+    {
+        /* If not specified, the device names should be "default". */
+
+        strlcpy(audio_in_name, pa->adevice_in, sizeof(audio_in_name));
+        strlcpy(audio_out_name, pa->adevice_out, sizeof(audio_out_name));
+
+        fprintf(stderr, "Audio device for both receive and transmit: %s\n", audio_in_name);
+
+        int err = snd_pcm_open(&(adev.audio_in_handle), audio_in_name, SND_PCM_STREAM_CAPTURE, 0);
+
+        if (err < 0)
+        {
+            return err;
+        }
+
+        adev.inbuf_size_in_bytes = set_alsa_params(adev.audio_in_handle, pa, audio_in_name, "input", &adev.in_mmap);
+
+        if (adev.inbuf_size_in_bytes <= 0)
+        {
+            return -1;
+        }
+
+        err = snd_pcm_open(&(adev.audio_out_handle), audio_out_name, SND_PCM_STREAM_PLAYBACK, 0);
+
+        if (err < 0)
+        {
+            return -1;
+        }
+
+        adev.outbuf_size_in_bytes = set_alsa_params(adev.audio_out_handle, pa, audio_out_name, "output", &adev.out_mmap);
+
+        if (adev.outbuf_size_in_bytes <= 0)
+        {
+            return -1;
+        }
+
+        adev.inbuf_ptr = (uint8_t *)calloc(adev.inbuf_size_in_bytes, sizeof(uint8_t));
+
+        if (adev.inbuf_ptr == NULL)
+            return -1;
+
+        adev.outbuf_ptr = (uint8_t *)calloc(adev.outbuf_size_in_bytes, sizeof(uint8_t));
+
+        if (adev.outbuf_ptr == NULL)
+            return -1;
+
+        adev.inbuf_len = 0;
+        adev.outbuf_len = 0;
+        adev.inbuf_next = 0;
+
+        alsa_wait();
+
+        return 0;
+    }
+
+    return -1;
+}
+
+static int set_alsa_params(snd_pcm_t *handle, struct audio_s *pa, char *devname, char *inout, bool *use_mmap)
+{
+    snd_pcm_hw_params_t *hw_params;
+
+    int err = snd_pcm_hw_params_malloc(&hw_params);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not alloc hw param (alloc) structure.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    err = snd_pcm_hw_params_any(handle, hw_params);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not init hw param (any) structure.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    /*
+     * Use the DMA ring directly if asked, and the device can
+     * do it, otherwise copy through our own buffer.
+     */
+    *use_mmap = false;
+
+    if (pa->mmap == true)
+    {
+        err = snd_pcm_hw_params_set_access(handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+
+        if (err < 0)
+        {
+            fprintf(stderr, "Audio %s %s can't do mmap, using read/write.\n", devname, inout);
+        }
+        else
+        {
+            *use_mmap = true;
+        }
+    }
+
+    if (*use_mmap == false)
+    {
+        err = snd_pcm_hw_params_set_access(handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+    }
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not set interleaved mode.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    err = snd_pcm_hw_params_set_format(handle, hw_params, SND_PCM_FORMAT_S16_LE);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not set sound format.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    err = snd_pcm_hw_params_set_channels(handle, hw_params, channels); // real only
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not set number of audio channels.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    /* Audio sample rate. */
+
+    unsigned int val = FS;
+
+    int dir = 0;
+
+    err = snd_pcm_hw_params_set_rate_near(handle, hw_params, &val, &dir);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Fatal: Could not set audio sample rate. %s ", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    if (val != (int)FS)
+    {
+        fprintf(stderr, "Fatal: Asked for %d samples/sec but got %d ", (int)FS, val);
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    int buf_size_in_bytes = roundup1k((val * (channels * bits_per_sample / 8) * ONE_BUF_TIME) / 1000);
+
+#if __arm__
+    /*
+     * RPi hack
+     *
+     * Reducing buffer size is fine for input
+     * but not so good for output
+     */
+    if (*inout == 'o')
+    {
+        buf_size_in_bytes = buf_size_in_bytes * 4;
+    }
+#endif
+
+    snd_pcm_uframes_t fpp = buf_size_in_bytes / (channels * bits_per_sample / 8); // stereo
+
+    dir = 0;
+
+    err = snd_pcm_hw_params_set_period_size_near(handle, hw_params, &fpp, &dir);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not set period size\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    err = snd_pcm_hw_params(handle, hw_params);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not set hw params\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    /*
+     * Driver might not like our suggested period size
+     * and might have another idea
+     */
+    err = snd_pcm_hw_params_get_period_size(hw_params, &fpp, NULL);
+
+    if (err < 0)
+    {
+        fprintf(stderr, "Could not get audio period size.\n%s\n", snd_strerror(err));
+        fprintf(stderr, "for %s %s.\n", devname, inout);
+        return -1;
+    }
+
+    snd_pcm_hw_params_free(hw_params);
+
+    /*
+     * A "frame" is one sample for all channels
+     *
+     * The read and write use units of frames, not bytes
+     */
+    adev.bytes_per_frame = snd_pcm_frames_to_bytes(handle, 1);
+
+    buf_size_in_bytes = fpp * adev.bytes_per_frame;
+
+    if (buf_size_in_bytes < 256 || buf_size_in_bytes > 32768)
+    {
+        buf_size_in_bytes = 2048;
+    }
+
+    return buf_size_in_bytes;
+}
+
+/*
+ * Refill the input buffer with one period from the soundcard
+ *
+ * Returns false if the device keeps failing
+ */
+static bool alsa_fill()
+{
+    int retries = 0;
+
+    while (1)
+    {
+        int err = snd_pcm_readi(adev.audio_in_handle, adev.inbuf_ptr, adev.inbuf_size_in_bytes / adev.bytes_per_frame);
+
+        if (err > 0)
+        {
+            adev.inbuf_len = err * adev.bytes_per_frame; /* convert to number of bytes */
+            adev.inbuf_next = 0;
+
+            return true;
+        }
+        else if (err == 0)
+        {
+            /*
+             * Didn't expect this, but it's not a problem
+             * Wait a little while and try again
+             */
+            fprintf(stderr, "Audio input got zero bytes: %s\n", snd_strerror(err));
+            SLEEP_MS(10);
+
+            adev.inbuf_len = 0;
+            adev.inbuf_next = 0;
+        }
+        else
+        {
+            fprintf(stderr, "Audio input device error code %d: %s\n", err, snd_strerror(err));
+
+            if (err == (-EPIPE))
+            {
+                fprintf(stderr, "Most likely a slow CPU unable to keep up with the audio stream.\n");
+            }
+
+            /*
+             * Try to recover a few times and eventually give up
+             */
+            if (++retries > 10)
+            {
+                adev.inbuf_len = 0;
+                adev.inbuf_next = 0;
+
+                return false;
+            }
+
+            if (err == -EPIPE)
+            {
+                /*
+                 * EPIPE means overrun
+                 */
+                snd_pcm_recover(adev.audio_in_handle, err, 1);
+            }
+            else
+            {
+                SLEEP_MS(250);
+                snd_pcm_recover(adev.audio_in_handle, err, 1);
+            }
+        }
+    }
+}
+
+/*
+ * Number of frames in one capture period
+ */
+static int alsa_period_frames()
+{
+    return adev.inbuf_size_in_bytes / adev.bytes_per_frame;
+}
+
+static int16_t *mmap_area(const snd_pcm_channel_area_t *areas, snd_pcm_uframes_t offset)
+{
+    return (int16_t *)((uint8_t *)areas[0].addr + ((areas[0].first + offset * areas[0].step) / 8));
+}
+
+/*
+ * Recover from an overrun/underrun or suspend on a mmap stream
+ *
+ * Returns false if the device can't be recovered
+ */
+static bool mmap_recover(snd_pcm_t *handle, int err, char *inout)
+{
+    if (err == -EPIPE)
+    {
+        fprintf(stderr, "Audio %s mmap xrun.\n", inout);
+    }
+    else
+    {
+        fprintf(stderr, "Audio %s mmap error: %s\n", inout, snd_strerror(err));
+    }
+
+    if (snd_pcm_recover(handle, err, 1) < 0)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Capture straight out of the DMA ring
+ */
+static int alsa_read_mmap(float samples[], int count)
+{
+    snd_pcm_t *handle = adev.audio_in_handle;
+    int period = alsa_period_frames();
+    int retries = 0;
+    int done = 0;
+
+    while (done < count)
+    {
+        if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+        {
+            snd_pcm_start(handle); // mmap capture doesn't start by itself
+        }
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+
+        if (avail < 0)
+        {
+            if (++retries > 10 || mmap_recover(handle, (int)avail, "input") == false)
+                return -1;
+
+            continue;
+        }
+
+        /*
+         * Sleep until a period or the rest of the request is there
+         */
+        if (avail < (count - done) && avail < period)
+        {
+            int err = snd_pcm_wait(handle, 1000);
+
+            if (err < 0)
+            {
+                if (++retries > 10 || mmap_recover(handle, err, "input") == false)
+                    return -1;
+            }
+
+            continue;
+        }
+
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = count - done;
+
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+
+        if (err < 0)
+        {
+            if (++retries > 10 || mmap_recover(handle, err, "input") == false)
+                return -1;
+
+            continue;
+        }
+
+        audio_s16_to_float(mmap_area(areas, offset), &samples[done], (int)frames);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+
+        if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+        {
+            if (++retries > 10 || mmap_recover(handle, (committed < 0) ? (int)committed : -EPIPE, "input") == false)
+                return -1;
+
+            if (committed < 0)
+                continue;
+        }
+
+        /*
+         * Frames not committed are still in the ring
+         * and are read again next time around
+         */
+        done += (int)committed;
+    }
+
+    return done;
+}
+
+/*
+ * Called by demod
+ *
+ * Fill samples[] with exactly count frames as float.
+ * Returns count, or -1 if the audio input failed.
+ */
+static int alsa_read(float samples[], int count)
+{
+    if (adev.in_mmap == true)
+    {
+        return alsa_read_mmap(samples, count);
+    }
+
+    int done = 0;
+
+    while (done < count)
+    {
+        if (adev.inbuf_next >= adev.inbuf_len)
+        {
+            if (alsa_fill() == false)
+                return -1;
+        }
+
+        int avail = (adev.inbuf_len - adev.inbuf_next) / adev.bytes_per_frame;
+        int n = ((count - done) < avail) ? (count - done) : avail;
+
+        audio_s16_to_float((const int16_t *)&adev.inbuf_ptr[adev.inbuf_next], &samples[done], n);
+
+        adev.inbuf_next += n * adev.bytes_per_frame;
+        done += n;
+    }
+
+    return done;
+}
+
+/*
+ * Called externally by tx.c
+ * but also internally
+ */
+static void alsa_flush()
+{
+    if (adev.out_mmap == true)
+    {
+        /*
+         * Samples are already in the ring, make sure it's playing
+         */
+        if (snd_pcm_state(adev.audio_out_handle) == SND_PCM_STATE_PREPARED && adev.out_pending > 0)
+        {
+            snd_pcm_start(adev.audio_out_handle);
+        }
+
+        adev.out_pending = 0;
+        return;
+    }
+
+    snd_pcm_status_t *status;
+
+    snd_pcm_status_alloca(&status);
+
+    int k = snd_pcm_status(adev.audio_out_handle, status);
+
+    if (k != 0)
+    {
+        fprintf(stderr, "Audio output get status error.\n%s\n", snd_strerror(k));
+    }
+
+    if ((k = snd_pcm_status_get_state(status)) != SND_PCM_STATE_RUNNING)
+    {
+        k = snd_pcm_prepare(adev.audio_out_handle);
+
+        if (k != 0)
+        {
+            fprintf(stderr, "Audio output start error.\n%s\n", snd_strerror(k));
+        }
+    }
+
+    uint8_t *psound = adev.outbuf_ptr;
+    int retries = 10;
+
+    while (retries-- > 0)
+    {
+        k = snd_pcm_writei(adev.audio_out_handle, psound, adev.outbuf_len / adev.bytes_per_frame);
+
+        if (k == -EPIPE)
+        {
+            fprintf(stderr, "Audio output data underrun.\n");
+            snd_pcm_recover(adev.audio_out_handle, k, 1);
+        }
+        else if (k == -ESTRPIPE)
+        {
+            fprintf(stderr, "Driver suspended, recovering\n");
+            snd_pcm_recover(adev.audio_out_handle, k, 1);
+        }
+        else if (k == -EBADFD)
+        {
+            k = snd_pcm_prepare(adev.audio_out_handle);
+
+            if (k < 0)
+            {
+                fprintf(stderr, "Error preparing after bad state: %s\n", snd_strerror(k));
+            }
+        }
+        else if (k < 0)
+        {
+            fprintf(stderr, "Audio write error: %s\n", snd_strerror(k));
+
+            k = snd_pcm_prepare(adev.audio_out_handle);
+
+            if (k < 0)
+            {
+                fprintf(stderr, "Error preparing after error: %s\n", snd_strerror(k));
+            }
+        }
+        else if (k != adev.outbuf_len / adev.bytes_per_frame)
+        {
+            fprintf(stderr, "Audio write took %d frames rather than %d.\n", k, adev.outbuf_len / adev.bytes_per_frame);
+
+            // Go around again with the rest of it
+
+            psound += k * adev.bytes_per_frame;
+            adev.outbuf_len -= k * adev.bytes_per_frame;
+        }
+        else
+        {
+            // Success!
+            adev.outbuf_len = 0;
+            return;
+        }
+    }
+
+    fprintf(stderr, "Audio write error retry count exceeded.\n");
+
+    adev.outbuf_len = 0;
+}
+
+/*
+ * Playback straight into the DMA ring
+ *
+ * The stream is started once a period is queued,
+ * or by alsa_flush() at the end of a transmission.
+ */
+static void alsa_write_mmap(const float samples[], int count)
+{
+    snd_pcm_t *handle = adev.audio_out_handle;
+    int period = adev.outbuf_size_in_bytes / adev.bytes_per_frame;
+    int retries = 0;
+
+    while (count > 0)
+    {
+        snd_pcm_state_t state = snd_pcm_state(handle);
+
+        if (state == SND_PCM_STATE_SETUP || state == SND_PCM_STATE_XRUN)
+        {
+            snd_pcm_prepare(handle);
+            adev.out_pending = 0;
+        }
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+
+        if (avail < 0)
+        {
+            if (++retries > 10 || mmap_recover(handle, (int)avail, "output") == false)
+                break;
+
+            adev.out_pending = 0;
+            continue;
+        }
+
+        if (avail == 0)
+        {
+            if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+            {
+                snd_pcm_start(handle); // ring is full
+            }
+
+            snd_pcm_wait(handle, 1000);
+            continue;
+        }
+
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = (count < avail) ? count : avail;
+
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+
+        if (err < 0)
+        {
+            if (++retries > 10 || mmap_recover(handle, err, "output") == false)
+                break;
+
+            continue;
+        }
+
+        audio_float_to_s16(samples, mmap_area(areas, offset), (int)frames);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+
+        if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+        {
+            if (++retries > 10 || mmap_recover(handle, (committed < 0) ? (int)committed : -EPIPE, "output") == false)
+                break;
+
+            if (committed < 0)
+                continue;
+        }
+
+        /*
+         * Frames not committed are written again
+         */
+        samples += committed;
+        count -= (int)committed;
+
+        if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+        {
+            adev.out_pending += (int)committed;
+
+            if (adev.out_pending >= period)
+            {
+                snd_pcm_start(handle);
+                adev.out_pending = 0;
+            }
+        }
+    }
+
+    if (count > 0)
+    {
+        fprintf(stderr, "Audio mmap write retry count exceeded.\n");
+    }
+}
+
+/*
+ * Called by modulate
+ *
+ * Queue count float samples for the soundcard.
+ * A full period is written each time the buffer fills.
+ */
+static void alsa_write(const float samples[], int count)
+{
+    if (adev.out_mmap == true)
+    {
+        alsa_write_mmap(samples, count);
+        return;
+    }
+
+    while (count > 0)
+    {
+        int space = (adev.outbuf_size_in_bytes - adev.outbuf_len) / adev.bytes_per_frame;
+        int n = (count < space) ? count : space;
+
+        audio_float_to_s16(samples, (int16_t *)&adev.outbuf_ptr[adev.outbuf_len], n);
+
+        adev.outbuf_len += n * adev.bytes_per_frame;
+        samples += n;
+        count -= n;
+
+        if (adev.outbuf_len == adev.outbuf_size_in_bytes)
+        {
+            alsa_flush();
+        }
+    }
+}
+
+static void alsa_wait()
+{
+    alsa_flush();
+    snd_pcm_drain(adev.audio_out_handle);
+}
+
+static void alsa_close()
+{
+    if (adev.audio_in_handle != NULL && adev.audio_out_handle != NULL)
+    {
+        alsa_wait();
+
+        snd_pcm_close(adev.audio_in_handle);
+        snd_pcm_close(adev.audio_out_handle);
+
+        adev.audio_in_handle = adev.audio_out_handle = NULL;
+
+        free(adev.inbuf_ptr);
+        free(adev.outbuf_ptr);
+
+        adev.inbuf_size_in_bytes = 0;
+        adev.inbuf_ptr = NULL;
+        adev.inbuf_len = 0;
+        adev.inbuf_next = 0;
+
+        adev.outbuf_size_in_bytes = 0;
+        adev.outbuf_ptr = NULL;
+        adev.outbuf_len = 0;
+    }
+}
+
+const struct audio_backend_s audio_alsa_backend = {
+    .name = "ALSA",
+    .realtime = true,
+    .open = alsa_open,
+    .read = alsa_read,
+    .period_frames = alsa_period_frames,
+    .write = alsa_write,
+    .flush = alsa_flush,
+    .wait = alsa_wait,
+    .close = alsa_close,
+};
@@ -0,0 +1,50 @@
+/*
+ * audio_backend.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audio.h"
+
+    /*
+     * One of these per audio source/sink.
+     * audio.c picks one in audio_open() and
+     * the rest of the program never knows which.
+     */
+    struct audio_backend_s
+    {
+        const char *name;
+        bool realtime; // false if samples can be read faster than FS
+        int (*open)(struct audio_s *);
+        int (*read)(float *, int);
+        int (*period_frames)(void);
+        void (*write)(const float *, int);
+        void (*flush)(void);
+        void (*wait)(void);
+        void (*close)(void);
+    };
+
+    extern const struct audio_backend_s audio_alsa_backend;
+    extern const struct audio_backend_s audio_file_backend;
+
+    void audio_set_backend(const struct audio_backend_s *);
+    void audio_s16_to_float(const int16_t *, float *, int);
+    void audio_float_to_s16(const float *, int16_t *, int);
+
+#ifdef __cplusplus
+}
+#endif
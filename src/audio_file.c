@@ -0,0 +1,432 @@
+/*
+ * audio_file.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Audio from a recording rather than a soundcard
+ *
+ * Input is a 16-bit mono WAV file at FS, or headerless
+ * S16_LE raw at FS. A name of - reads stdin.
+ *
+ * Transmit audio goes to the output file in the same
+ * format (WAV if the name ends in .wav), or stdout for -.
+ * With no output file transmit audio is discarded.
+ *
+ * There is no clock, the receiver runs as fast as the
+ * CPU allows, and the end of input shuts the node down.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+
+#include "ipnode.h"
+#include "audio.h"
+#include "audio_backend.h"
+
+#define FILE_PERIOD 960 // frames, 100 mS at FS
+#define WAV_HEADER 44
+
+static struct
+{
+    FILE *in;
+    FILE *out;
+
+    long data_left; // WAV data bytes still to read, -1 if unknown
+    bool in_eof;
+    bool out_wav;
+    long out_frames;
+
+    int16_t inbuf[FILE_PERIOD];
+    int16_t outbuf[FILE_PERIOD];
+    int inbuf_len; // frames
+    int inbuf_next;
+    int outbuf_len;
+} fdev;
+
+static void file_flush(void);
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+/*
+ * Read and throw away n bytes, works on pipes too
+ */
+static bool skip_bytes(FILE *fp, long n)
+{
+    uint8_t scratch[256];
+
+    while (n > 0)
+    {
+        size_t len = (n < (long)sizeof(scratch)) ? (size_t)n : sizeof(scratch);
+
+        if (fread(scratch, 1, len, fp) != len)
+            return false;
+
+        n -= len;
+    }
+
+    return true;
+}
+
+/*
+ * Walk the WAV chunks up to the data
+ *
+ * The RIFF/WAVE tag has already been read.
+ */
+static bool read_wav_header(const char *name)
+{
+    uint8_t chunk[8];
+    uint8_t fmt[16];
+    bool have_fmt = false;
+
+    while (fread(chunk, 1, sizeof(chunk), fdev.in) == sizeof(chunk))
+    {
+        long size = (long)get32(&chunk[4]);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            if (fread(fmt, 1, sizeof(fmt), fdev.in) != sizeof(fmt) || skip_bytes(fdev.in, (size - 16) + (size & 1)) == false)
+                break;
+
+            int format = get16(&fmt[0]);
+            int chans = get16(&fmt[2]);
+            long rate = (long)get32(&fmt[4]);
+            int bits = get16(&fmt[14]);
+
+            if ((format != 1 && format != 0xFFFE) || chans != 1 || bits != 16)
+            {
+                fprintf(stderr, "%s: Need 16-bit mono PCM, got format %d, %d channels, %d bits\n", name, format, chans, bits);
+                return false;
+            }
+
+            if (rate != (long)FS)
+            {
+                fprintf(stderr, "%s: Sample rate is %ld, resample to %d first\n", name, rate, (int)FS);
+                return false;
+            }
+
+            have_fmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (have_fmt == false)
+            {
+                fprintf(stderr, "%s: WAV data before format\n", name);
+                return false;
+            }
+
+            /*
+             * Streamed WAV files often leave the size as 0 or -1
+             */
+            fdev.data_left = (size == 0 || size == 0xFFFFFFFFL) ? -1L : size;
+
+            return true;
+        }
+        else if (skip_bytes(fdev.in, size + (size & 1)) == false)
+        {
+            break;
+        }
+    }
+
+    fprintf(stderr, "%s: No WAV audio data found\n", name);
+    return false;
+}
+
+static bool open_input(const char *name)
+{
+    uint8_t tag[12];
+
+    if (strcmp(name, "-") == 0)
+    {
+        fdev.in = stdin;
+    }
+    else if ((fdev.in = fopen(name, "rb")) == NULL)
+    {
+        fprintf(stderr, "Could not open audio input file %s\n", name);
+        return false;
+    }
+
+    fdev.data_left = -1L;
+
+    size_t n = fread(tag, 1, sizeof(tag), fdev.in);
+
+    if (n == sizeof(tag) && memcmp(tag, "RIFF", 4) == 0 && memcmp(&tag[8], "WAVE", 4) == 0)
+    {
+        fprintf(stderr, "Audio input from WAV file %s\n", name);
+
+        return read_wav_header(name);
+    }
+
+    /*
+     * Raw samples, the tag bytes are the first of them
+     */
+    fprintf(stderr, "Audio input from raw S16_LE file %s\n", name);
+
+    memcpy(fdev.inbuf, tag, n & ~1);
+    fdev.inbuf_len = n / 2;
+
+    return true;
+}
+
+static void write_wav_header(uint32_t frames)
+{
+    uint8_t h[WAV_HEADER];
+
+    memcpy(&h[0], "RIFF", 4);
+    put32(&h[4], 36 + frames * 2);
+    memcpy(&h[8], "WAVEfmt ", 8);
+    put32(&h[16], 16);
+    put16(&h[20], 1);             // PCM
+    put16(&h[22], 1);             // mono
+    put32(&h[24], (uint32_t)FS);
+    put32(&h[28], (uint32_t)FS * 2);
+    put16(&h[32], 2);             // block align
+    put16(&h[34], 16);            // bits
+    memcpy(&h[36], "data", 4);
+    put32(&h[40], frames * 2);
+
+    fwrite(h, 1, sizeof(h), fdev.out);
+}
+
+static bool open_output(const char *name)
+{
+    size_t len = strlen(name);
+
+    if (len == 0)
+    {
+        fdev.out = NULL;
+        return true;
+    }
+
+    if (strcmp(name, "-") == 0)
+    {
+        /*
+         * Keep the real stdout for audio, and send
+         * anything printed from here on to stderr
+         */
+        int fd = dup(STDOUT_FILENO);
+
+        if (fd < 0 || (fdev.out = fdopen(fd, "wb")) == NULL)
+        {
+            fprintf(stderr, "Could not open stdout for audio output\n");
+            return false;
+        }
+
+        fflush(stdout);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+
+        fprintf(stderr, "Audio output to stdout\n");
+        return true;
+    }
+
+    if ((fdev.out = fopen(name, "wb")) == NULL)
+    {
+        fprintf(stderr, "Could not open audio output file %s\n", name);
+        return false;
+    }
+
+    fdev.out_wav = (len > 4 && strcasecmp(&name[len - 4], ".wav") == 0);
+
+    if (fdev.out_wav == true)
+    {
+        write_wav_header(0); // sizes are patched on close
+    }
+
+    fprintf(stderr, "Audio output to %s file %s\n", fdev.out_wav ? "WAV" : "raw S16_LE", name);
+
+    return true;
+}
+
+static int file_open(struct audio_s *pa)
+{
+    memset(&fdev, 0, sizeof(fdev));
+
+    if (open_input(pa->input_file) == false)
+    {
+        return -1;
+    }
+
+    if (open_output(pa->output_file) == false)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Samples are little endian on disk, as they
+ * are in memory on every target we build for.
+ */
+static bool file_fill()
+{
+    size_t want = FILE_PERIOD;
+
+    if (fdev.data_left >= 0 && (long)(want * 2) > fdev.data_left)
+    {
+        want = fdev.data_left / 2;
+    }
+
+    size_t n = (want > 0) ? fread(fdev.inbuf, sizeof(int16_t), want, fdev.in) : 0;
+
+    if (fdev.data_left >= 0)
+    {
+        fdev.data_left -= n * 2;
+    }
+
+    fdev.inbuf_len = n;
+    fdev.inbuf_next = 0;
+
+    return n > 0;
+}
+
+/*
+ * The last partial block is padded with silence,
+ * and the call after that returns -1.
+ */
+static int file_read(float samples[], int count)
+{
+    int done = 0;
+
+    if (fdev.in_eof == true)
+    {
+        return -1;
+    }
+
+    while (done < count)
+    {
+        if (fdev.inbuf_next >= fdev.inbuf_len && file_fill() == false)
+        {
+            fdev.in_eof = true;
+
+            if (done == 0)
+                return -1;
+
+            memset(&samples[done], 0, (count - done) * sizeof(float));
+
+            return count;
+        }
+
+        int avail = fdev.inbuf_len - fdev.inbuf_next;
+        int n = ((count - done) < avail) ? (count - done) : avail;
+
+        audio_s16_to_float(&fdev.inbuf[fdev.inbuf_next], &samples[done], n);
+
+        fdev.inbuf_next += n;
+        done += n;
+    }
+
+    return done;
+}
+
+static int file_period_frames()
+{
+    return FILE_PERIOD;
+}
+
+static void file_write(const float samples[], int count)
+{
+    while (count > 0)
+    {
+        int space = FILE_PERIOD - fdev.outbuf_len;
+        int n = (count < space) ? count : space;
+
+        audio_float_to_s16(samples, &fdev.outbuf[fdev.outbuf_len], n);
+
+        fdev.outbuf_len += n;
+        samples += n;
+        count -= n;
+
+        if (fdev.outbuf_len == FILE_PERIOD)
+        {
+            file_flush();
+        }
+    }
+}
+
+static void file_flush()
+{
+    if (fdev.out != NULL && fdev.outbuf_len > 0)
+    {
+        fdev.out_frames += fwrite(fdev.outbuf, sizeof(int16_t), fdev.outbuf_len, fdev.out);
+    }
+
+    fdev.outbuf_len = 0;
+}
+
+static void file_wait()
+{
+    file_flush();
+
+    if (fdev.out != NULL)
+    {
+        fflush(fdev.out);
+    }
+}
+
+static void file_close()
+{
+    file_wait();
+
+    if (fdev.out != NULL)
+    {
+        if (fdev.out_wav == true && fseek(fdev.out, 0L, SEEK_SET) == 0)
+        {
+            write_wav_header((uint32_t)fdev.out_frames);
+        }
+
+        fclose(fdev.out);
+        fdev.out = NULL;
+    }
+
+    if (fdev.in != NULL && fdev.in != stdin)
+    {
+        fclose(fdev.in);
+    }
+
+    fdev.in = NULL;
+}
+
+const struct audio_backend_s audio_file_backend = {
+    .name = "file",
+    .realtime = false,
+    .open = file_open,
+    .read = file_read,
+    .period_frames = file_period_frames,
+    .write = file_write,
+    .flush = file_flush,
+    .wait = file_wait,
+    .close = file_close,
+};
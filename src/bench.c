@@ -0,0 +1,805 @@
+/*
+ * bench.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * DSP and framing micro benchmarks (ipnode -B)
+ *
+ * Each benchmark times one modem stage on its own, with
+ * synthetic input, and prints its throughput. -B alone
+ * runs them all, -Bname runs just the one named.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#include <time.h>
+
+#include "ipnode.h"
+#include "bench.h"
+#include "ted.h"
+#include "nco.h"
+#include "rrc_fir.h"
+#include "symbol_sync.h"
+#include "costas_loop.h"
+#include "constellation.h"
+#include "il2p.h"
+#include "receive_queue.h"
+
+#define BENCH_SECONDS 0.5
+
+struct bench_s
+{
+    const char *name;
+    const char *help;
+    void (*run)(void);
+};
+
+/*
+ * Keeps the compiler from dropping the work being timed
+ */
+static volatile float bench_sink;
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * A repeating set of on-time and midpoint
+ * interpolants, like the symbol sync makes
+ */
+static void make_symbols(complex float buf[], int count)
+{
+    unsigned seed = 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+
+        float re = (seed & 0x10000) ? 0.7f : -0.7f;
+        float im = (seed & 0x20000) ? 0.7f : -0.7f;
+
+        buf[i] = (i & 1) ? CMPLXF(re * 0.1f, im * 0.1f) : CMPLXF(re, im);
+    }
+}
+
+static void bench_ted()
+{
+    complex float buf[1024];
+    long inputs = 0;
+    float sum = 0.0f;
+
+    make_symbols(buf, 1024);
+    create_timing_error_detector();
+
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < 1024; i++)
+        {
+            ted_input(buf[i]);
+            sum += get_error();
+        }
+
+        inputs += 1024;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    bench_sink = sum;
+
+    printf("%-8s %8.2f ns per input, %7.2f M symbols/s, %6.0f times a %d Bd channel\n",
+           "ted", (elapsed * 1e9) / inputs, (inputs / 2) / elapsed / 1e6,
+           (inputs / 2) / elapsed / RS, (int)RS);
+}
+
+/*
+ * Passband mixer throughput, and how far the oscillator
+ * amplitude has wandered after an hour of samples
+ */
+static void bench_nco()
+{
+    static float in[NCO_BLOCK * 16];
+    static complex float out[NCO_BLOCK * 16];
+    struct nco_s nco;
+    long samples = 0;
+
+    for (int i = 0; i < NCO_BLOCK * 16; i++)
+        in[i] = sinf(i * 0.1f);
+
+    nco_init(&nco, -CENTER, FS);
+
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        nco_mix_down(&nco, in, out, NCO_BLOCK * 16);
+
+        samples += NCO_BLOCK * 16;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    bench_sink = crealf(out[0]);
+
+    float ns_nco = (elapsed * 1e9) / samples;
+
+    /*
+     * The per-sample recurrence it replaced
+     */
+    complex float phase = 1.0f;
+    complex float rect = cmplxconj((TAU * CENTER) / FS);
+
+    samples = 0;
+    start = now_seconds();
+
+    do
+    {
+        for (int i = 0; i < NCO_BLOCK * 16; i++)
+        {
+            phase *= rect;
+            out[i] = phase * in[i];
+        }
+
+        samples += NCO_BLOCK * 16;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    bench_sink = crealf(out[0]);
+
+    float ns_rec = (elapsed * 1e9) / samples;
+
+    long hour = (long)FS * 3600L;
+    float drift_nco = 0.0f;
+
+    phase = 1.0f;
+    nco_init(&nco, CENTER, FS);
+
+    for (long i = 0; i < hour; i += NCO_BLOCK)
+    {
+        complex float osc[NCO_BLOCK];
+
+        nco_block(&nco, osc, NCO_BLOCK);
+
+        for (int k = 0; k < NCO_BLOCK; k++)
+        {
+            float d = fabsf(cabsf(osc[k]) - 1.0f);
+
+            if (d > drift_nco)
+                drift_nco = d;
+
+            phase *= rect;
+        }
+    }
+
+    printf("%-8s %8.2f ns per sample (recurrence %.2f), amplitude error after an hour %.1e (recurrence %.1e)\n",
+           "nco", ns_nco, ns_rec, drift_nco, fabsf(cabsf(phase) - 1.0f));
+}
+
+#define RRC_BLOCK 1024
+
+/*
+ * Receive filter on every sample, the circular history
+ * against the original shifting filter. The outputs are
+ * compared as well.
+ */
+static void bench_rrc()
+{
+    static complex float in[RRC_BLOCK];
+    static complex float a[RRC_BLOCK];
+    static complex float b[RRC_BLOCK];
+    complex float memory[NTAPS];
+    struct rrc_fir_s filter;
+    double rate[2];
+    float worst = 0.0f;
+
+    for (int i = 0; i < RRC_BLOCK; i++)
+        in[i] = CMPLXF(sinf(i * 0.654f), cosf(i * 0.321f)) * 0.5f;
+
+    rrc_make(FS, RS, .35f);
+
+    for (int k = 0; k < 2; k++)
+    {
+        long count = 0;
+        double start = now_seconds();
+        double elapsed;
+
+        rrc_fir_init(&filter);
+        memset(memory, 0, sizeof(memory));
+
+        do
+        {
+            complex float *out = (k == 0) ? a : b;
+
+            memcpy(out, in, sizeof(in));
+
+            if (k == 0)
+                rrc_fir(&filter, out, RRC_BLOCK);
+            else
+                rrc_fir_shift(memory, out, RRC_BLOCK);
+
+            count += RRC_BLOCK;
+            elapsed = now_seconds() - start;
+        } while (elapsed < BENCH_SECONDS / 2);
+
+        rate[k] = count / elapsed;
+    }
+
+    /*
+     * Same history in both, so the last blocks agree
+     */
+    rrc_fir_init(&filter);
+    memset(memory, 0, sizeof(memory));
+    memcpy(a, in, sizeof(in));
+    memcpy(b, in, sizeof(in));
+    rrc_fir(&filter, a, RRC_BLOCK);
+    rrc_fir_shift(memory, b, RRC_BLOCK);
+
+    for (int i = 0; i < RRC_BLOCK; i++)
+        worst = fmaxf(worst, cabsf(a[i] - b[i]));
+
+    bench_sink = crealf(a[0]);
+
+    printf("%-8s %8.2f M samples/s (shifting history %.2f), %.1fx, %s kernel, largest difference %.2e\n",
+           "rrc", rate[0] / 1e6, rate[1] / 1e6, rate[0] / rate[1], rrc_fir_kernel_name(), worst);
+}
+
+/*
+ * Receive front end per symbol, mixer through to the
+ * on-time sample, against filtering every sample
+ */
+static void bench_rxfront()
+{
+    static float in[CYCLES * 1024];
+    complex float block[CYCLES];
+    complex float symbols[SYMSYNC_MAX_OUT];
+    struct nco_s nco;
+    struct rrc_fir_s filter;
+    long count = 0;
+    complex float sum = 0.0f;
+
+    for (int i = 0; i < CYCLES * 1024; i++)
+        in[i] = sinf(i * 0.654f) * 0.5f;
+
+    rrc_make(FS, RS, .35f);
+    nco_init(&nco, -CENTER, FS);
+    rrc_fir_init(&filter);
+
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < CYCLES * 1024; i += CYCLES)
+        {
+            nco_mix_down(&nco, &in[i], block, CYCLES);
+            rrc_fir(&filter, block, CYCLES);
+            sum += block[0];
+        }
+
+        count += 1024;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    float ns_full = (elapsed * 1e9) / count;
+
+    create_timing_error_detector();
+    create_symbol_sync((float)CYCLES, SYMSYNC_LOOP_BW, SYMSYNC_DAMPING, SYMSYNC_MAX_DEV);
+
+    count = 0;
+    start = now_seconds();
+
+    do
+    {
+        for (int i = 0; i < CYCLES * 1024; i += CYCLES)
+        {
+            nco_mix_down(&nco, &in[i], block, CYCLES);
+
+            int n = symbol_sync(block, CYCLES, symbols);
+
+            if (n > 0)
+                sum += symbols[0];
+        }
+
+        count += 1024;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    bench_sink = crealf(sum);
+
+    printf("%-8s %8.2f ns per symbol (filtering every sample %.2f), %s kernel\n",
+           "rxfront", (elapsed * 1e9) / count, ns_full, rrc_fir_kernel_name());
+}
+
+/*
+ * Costas derotation, table against the cosf/sinf and complex
+ * multiply it replaced, and the worst error of the table
+ */
+static void bench_phasor()
+{
+    static float phase[4096];
+    static complex float symbol[4096];
+    long count = 0;
+    complex float sum = 0.0f;
+    unsigned seed = 1;
+
+    create_control_loop((TAU / 180.0f), -1.0f, 1.0f);
+    make_symbols(symbol, 4096);
+
+    for (int i = 0; i < 4096; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        phase[i] = (((seed >> 8) / 16777216.0f) * 2.0f - 1.0f) * (float)TAU; // the phase_wrap() range
+    }
+
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < 4096; i++)
+        {
+            set_phase(phase[i]);
+            sum += derotate(symbol[i]);
+        }
+
+        count += 4096;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    float ns_table = (elapsed * 1e9) / count;
+
+    count = 0;
+    start = now_seconds();
+
+    do
+    {
+        for (int i = 0; i < 4096; i++)
+        {
+            set_phase(phase[i]);
+            sum += symbol[i] * cmplxconj(get_phase());
+        }
+
+        count += 4096;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    bench_sink = crealf(sum);
+
+    float ns_libm = (elapsed * 1e9) / count;
+    double max_phase = 0.0;
+    double max_amp = 0.0;
+
+    for (int i = 0; i < 1000000; i++)
+    {
+        float p = (((float)i / 500000.0f) - 1.0f) * (float)TAU;
+        complex float z = phasor(p);
+        double dp = fabs(remainder(carg(z) - (double)p, TAU));
+        double da = fabs(cabs(z) - 1.0);
+
+        if (dp > max_phase)
+            max_phase = dp;
+
+        if (da > max_amp)
+            max_amp = da;
+    }
+
+    printf("%-8s %8.2f ns per symbol (cosf/sinf %.2f), worst phase error %.1e rad, amplitude %.1e\n",
+           "phasor", ns_table, ns_libm, max_phase, max_amp);
+}
+
+/*
+ * Remove and count the frames the framer has queued
+ */
+static int drain_frames()
+{
+    struct rx_queue_item_s *pitem;
+    int count = 0;
+
+    while ((pitem = rx_queue_remove()) != NULL)
+    {
+        if (pitem->type == RXQ_REC_FRAME && pitem->pp != NULL)
+            count++;
+
+        rx_queue_delete(pitem);
+    }
+
+    return count;
+}
+
+/*
+ * IL2P framer and decoder, from sliced dibits to AX.25
+ * frames. The test vector is BENCH_FRAMES frames with
+ * their preamble, received a quarter turn out so the
+ * dibit mapping is exercised too.
+ */
+#define BENCH_FRAMES 8
+#define BENCH_INFO 200
+#define BENCH_PREAMBLE 16
+
+static void bench_framer()
+{
+    static uint8_t vec[BENCH_FRAMES * (BENCH_PREAMBLE * 2 + IL2P_MAX_PACKET_SIZE)];
+    char addrs[AX25_ADDRS][AX25_MAX_ADDR_LEN] = {"N0CALL", "K5OKC"};
+    uint8_t info[BENCH_INFO];
+    uint8_t turned[256];
+    int len = 0;
+
+    rx_queue_init();
+    il2p_init();
+
+    for (int i = 0; i < BENCH_INFO; i++)
+        info[i] = (uint8_t)(i * 37);
+
+    for (int b = 0; b < 256; b++)
+    {
+        turned[b] = (qpskRotateDiBit((b >> 6) & 0x3) << 6) | (qpskRotateDiBit((b >> 4) & 0x3) << 4) |
+                    (qpskRotateDiBit((b >> 2) & 0x3) << 2) | qpskRotateDiBit(b & 0x3);
+    }
+
+    for (int f = 0; f < BENCH_FRAMES; f++)
+    {
+        packet_t pp = ax25_u_frame(addrs, cr_cmd, frame_type_U_UI, 0, 0xF0, info, BENCH_INFO);
+
+        /*
+         * A preamble byte is 8 BPSK symbols, two bytes of dibits
+         */
+        memset(&vec[len], (FLAG & 0x80) ? 0xFF : 0x00, BENCH_PREAMBLE * 2);
+        len += BENCH_PREAMBLE * 2;
+
+        vec[len++] = (IL2P_SYNC_WORD >> 16) & 0xff;
+        vec[len++] = (IL2P_SYNC_WORD >> 8) & 0xff;
+        vec[len++] = IL2P_SYNC_WORD & 0xff;
+
+        len += il2p_encode_frame(pp, &vec[len]);
+
+        ax25_delete(pp);
+    }
+
+    for (int i = 0; i < len; i++)
+        vec[i] = turned[vec[i]];
+
+    long bits = 0;
+    int frames = 0;
+
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < len; i++)
+        {
+            for (int shift = 6; shift >= 0; shift -= 2)
+                il2p_rec_dibit((vec[i] >> shift) & 0x3, 1.0f, 1.0f);
+        }
+
+        frames += drain_frames();
+        bits += len * 8L;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    double rate_dibit = bits / elapsed;
+    int passes = bits / (len * 8L);
+    int frames_dibit = frames;
+
+    bits = 0;
+    frames = 0;
+    start = now_seconds();
+
+    do
+    {
+        il2p_rec_bytes(vec, NULL, len);
+
+        frames += drain_frames();
+        bits += len * 8L;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    printf("%-8s %8.2f M bits/s by dibit, %.2f M bits/s by byte, %d/%d and %ld/%ld frames decoded\n",
+           "framer", rate_dibit / 1e6, bits / elapsed / 1e6, frames_dibit, passes * BENCH_FRAMES,
+           (long)frames, (bits / (len * 8L)) * BENCH_FRAMES);
+}
+
+/*
+ * Scrambler output from the original bit serial code, for
+ * input bytes i * 37 + 11. The digest is FNV-1a over the
+ * scrambled then descrambled blocks of 1 to 239 bytes of
+ * i * 37 + len.
+ */
+static const uint8_t scramble_golden[IL2P_HEADER_SIZE] = {
+    0x04, 0xfd, 0xf4, 0xcc, 0x3a, 0x7e, 0x35, 0x40, 0x9a, 0xbe, 0xce, 0x27, 0xae
+};
+
+#define SCRAMBLE_DIGEST 0x2f269febU
+
+static bool scramble_check()
+{
+    uint8_t in[239];
+    uint8_t out[239];
+    uint32_t h = 2166136261U;
+
+    for (int i = 0; i < IL2P_HEADER_SIZE; i++)
+        in[i] = (uint8_t)(i * 37 + 11);
+
+    il2p_scramble_block(in, out, IL2P_HEADER_SIZE);
+
+    if (memcmp(out, scramble_golden, IL2P_HEADER_SIZE) != 0)
+        return false;
+
+    for (int len = 1; len <= 239; len++)
+    {
+        for (int i = 0; i < len; i++)
+            in[i] = (uint8_t)(i * 37 + len);
+
+        il2p_scramble_block(in, out, len);
+
+        for (int i = 0; i < len; i++)
+            h = (h ^ out[i]) * 16777619U;
+
+        il2p_descramble_block(in, out, len);
+
+        for (int i = 0; i < len; i++)
+            h = (h ^ out[i]) * 16777619U;
+    }
+
+    return h == SCRAMBLE_DIGEST;
+}
+
+/*
+ * Table scrambler and descrambler on full payload
+ * blocks, against the bit serial reference
+ */
+static void bench_scramble()
+{
+    static uint8_t in[239];
+    static uint8_t out[239];
+    void (*funcs[4])(uint8_t *, uint8_t *, int) = {
+        il2p_scramble_block, il2p_scramble_block_bits,
+        il2p_descramble_block, il2p_descramble_block_bits
+    };
+    double ns[4];
+
+    il2p_scramble_init();
+
+    for (int i = 0; i < 239; i++)
+        in[i] = (uint8_t)(i * 101);
+
+    for (int f = 0; f < 4; f++)
+    {
+        long count = 0;
+        double start = now_seconds();
+        double elapsed;
+
+        do
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                funcs[f](in, out, 239);
+                in[0] ^= out[238];
+            }
+
+            count += 256;
+            elapsed = now_seconds() - start;
+        } while (elapsed < BENCH_SECONDS / 2);
+
+        ns[f] = (elapsed * 1e9) / count;
+    }
+
+    bench_sink = out[0];
+
+    printf("%-8s %8.2f ns per 239 byte block (bits %.2f), descramble %.2f (bits %.2f), %.0f MB/s, golden vectors %s\n",
+           "scramble", ns[0], ns[1], ns[2], ns[3], 239e3 / ns[0], scramble_check() ? "match" : "DIFFER");
+}
+
+/*
+ * One block through the decoder, len bytes long. With pad
+ * set the block is put at the end of a zeroed 255 byte
+ * buffer and decoded whole, as the decoder used to do.
+ */
+static double rs_time(struct rs *rs, const uint8_t block[], int len, int errors, bool pad)
+{
+    uint8_t buf[255];
+    int derrlocs[255];
+    int off = pad ? 255 - len : 0;
+    long count = 0;
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            memset(buf, 0, off);
+            memcpy(buf + off, block, len);
+
+            for (int e = 0; e < errors; e++)
+                buf[off + (e * 7 + i) % len] ^= 0x5a;
+
+            bench_sink = decode_rs_char(rs, buf, off + len, derrlocs, 0);
+        }
+
+        count += 256;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS / 4);
+
+    return (elapsed * 1e9) / count;
+}
+
+/*
+ * Reed-Solomon decode of a header and of a short and a
+ * full payload block, each with a correctable number of
+ * errors, shortened and padded out to 255
+ */
+static void bench_rs()
+{
+    static const int sizes[3][3] = {
+        {IL2P_HEADER_SIZE, IL2P_HEADER_PARITY, 1},
+        {64, 16, 8},
+        {239, 16, 8}
+    };
+    uint8_t block[255];
+
+    il2p_init();
+
+    for (int s = 0; s < 3; s++)
+    {
+        int data = sizes[s][0];
+        int nroots = sizes[s][1];
+        struct rs *rs = il2p_find_rs(nroots);
+
+        for (int i = 0; i < data; i++)
+            block[i] = (uint8_t)(i * 29 + 3);
+
+        il2p_encode_rs(block, data, nroots, block + data);
+
+        double ns = rs_time(rs, block, data + nroots, sizes[s][2], false);
+        double padded = rs_time(rs, block, data + nroots, sizes[s][2], true);
+
+        printf("%-8s %3d+%-2d %d errors %8.0f ns per block, padded to 255 %8.0f ns, %.1fx\n",
+               "rs", data, nroots, sizes[s][2], ns, padded, padded / ns);
+    }
+}
+
+/*
+ * Vector syndrome and parity kernels against the scalar
+ * code, every code length at every IL2P parity count
+ */
+static bool gf_check()
+{
+    static const int parity[] = {2, 4, 6, 8, 16};
+    uint8_t block[255];
+    uint8_t a[16];
+    uint8_t b[16];
+
+    for (int p = 0; p < 5; p++)
+    {
+        struct rs *rs = il2p_find_rs(parity[p]);
+
+        for (int len = 1; len <= 255; len++)
+        {
+            for (int i = 0; i < len; i++)
+                block[i] = (uint8_t)(rand() & 0xff);
+
+            rs_syndromes(rs, block, len, a);
+            rs_syndromes_scalar(rs, block, len, b);
+
+            if (memcmp(a, b, parity[p]) != 0)
+                return false;
+
+            if (len > 255 - parity[p])
+                continue;
+
+            rs_parity(rs, block, len, a);
+            rs_parity_scalar(rs, block, len, b);
+
+            if (memcmp(a, b, parity[p]) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static double gf_time(void (*func)(struct rs *, const uint8_t *, int, uint8_t *), struct rs *rs, uint8_t block[], int len)
+{
+    uint8_t out[16];
+    long count = 0;
+    double start = now_seconds();
+    double elapsed;
+
+    do
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            func(rs, block, len, out);
+            block[0] ^= out[0];
+        }
+
+        count += 256;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_SECONDS / 4);
+
+    return (elapsed * 1e9) / count;
+}
+
+/*
+ * 16 syndromes of a full 255 byte block and 16
+ * parity bytes of 239, vector and scalar
+ */
+static void bench_gf()
+{
+    uint8_t block[255];
+
+    il2p_init();
+
+    struct rs *rs = il2p_find_rs(16);
+
+    for (int i = 0; i < 255; i++)
+        block[i] = (uint8_t)(i * 29 + 3);
+
+    double syn = gf_time(rs_syndromes, rs, block, 255);
+    double syn_scalar = gf_time(rs_syndromes_scalar, rs, block, 255);
+    double par = gf_time(rs_parity, rs, block, 239);
+    double par_scalar = gf_time(rs_parity_scalar, rs, block, 239);
+
+    printf("%-8s syndromes %6.0f ns (scalar %6.0f), parity %6.0f ns (scalar %6.0f), %s kernel, %s\n",
+           "gf", syn, syn_scalar, par, par_scalar, il2p_gf_kernel_name(),
+           gf_check() ? "bit exact" : "DIFFER");
+}
+
+static const struct bench_s benches[] = {
+    {"ted", "Gardner timing error detector update", bench_ted},
+    {"rrc", "Receive filter, circular against shifting history", bench_rrc},
+    {"nco", "Passband mixer oscillator", bench_nco},
+    {"rxfront", "Mixer, matched filter and timing loop", bench_rxfront},
+    {"phasor", "Costas loop derotation phasor", bench_phasor},
+    {"framer", "IL2P sync, framing and decode", bench_framer},
+    {"scramble", "IL2P scrambler and descrambler", bench_scramble},
+    {"rs", "IL2P Reed-Solomon decode", bench_rs},
+    {"gf", "IL2P GF(256) syndrome and parity kernels", bench_gf},
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+int bench_run(const char *which)
+{
+    bool found = false;
+
+    for (size_t i = 0; i < NUM_BENCHES; i++)
+    {
+        if (which == NULL || strcmp(which, benches[i].name) == 0)
+        {
+            benches[i].run();
+            found = true;
+        }
+    }
+
+    if (found == false)
+    {
+        fprintf(stderr, "Unknown benchmark %s, choose from:\n", which);
+
+        for (size_t i = 0; i < NUM_BENCHES; i++)
+        {
+            fprintf(stderr, "  %-8s %s\n", benches[i].name, benches[i].help);
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * bench.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    int bench_run(const char *);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,578 @@
+/*
+ * channel_sim.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Modem loopback through a simulated channel
+ *
+ * Frames are modulated by the real transmit code, passed
+ * through AWGN, carrier offset, sample clock drift and a
+ * two-path channel, and then demodulated by the real
+ * receive code. No threads, no soundcard.
+ *
+ * Reports packet error rate against Eb/N0, and the CPU
+ * time the receive DSP needs per second of audio, so the
+ * numbers can be compared from release to release.
+ *
+ * ipnode -S[key=value,...]
+ *
+ *   ebn0=start:stop:step   dB sweep, default 0:14:2
+ *   n=frames               frames per point, default 100
+ *   len=bytes              info field length, default 64
+ *   cfo=Hz                 carrier offset, default 0
+ *   ppm=ppm                sample clock error, default 0
+ *   mp=gain:delay          second path gain and delay in samples
+ *   seed=n                 noise seed, default 1
+ *   txdelay=n              preamble in 10 mS units, default from the config
+ *
+ * Reference PER, n=400 and the other defaults, with the
+ * lost frames by where they failed:
+ *
+ *   Eb/N0 dB   0      2      4      6      8      10-14
+ *   PER      1.000  1.000  0.427  0.013  0.000  0.000
+ *   Sync       319    179     57      2      0      0
+ *   Header      74    189     87      3      0      0
+ *   Payload      7     32     27      0      0      0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include <bsd/string.h>
+
+#include "ipnode.h"
+#include "audio.h"
+#include "audio_backend.h"
+#include "channel_sim.h"
+#include "constellation.h"
+#include "costas_loop.h"
+#include "rrc_fir.h"
+#include "ted.h"
+#include "symbol_sync.h"
+#include "freq_acq.h"
+#include "il2p.h"
+#include "receive_queue.h"
+#include "receive_thread.h"
+#include "transmit_thread.h"
+
+#define HILBERT_TAPS 63
+#define GAP_MS 100 // noise between frames
+#define BITS_PER_SYMBOL 2
+#define MS_TO_FLAGS(ms) ((((ms)*1200) / 875) / 8) // as the transmitter counts them
+
+/*
+ * Transmit audio lands here instead of a soundcard
+ */
+static float *sim_tx;
+static int sim_tx_len;
+static int sim_tx_size;
+
+static float hilbert[HILBERT_TAPS];
+static uint64_t prng;
+
+static double cfo_phase;
+
+static void sim_write(const float samples[], int count)
+{
+    if (sim_tx_len + count > sim_tx_size)
+    {
+        sim_tx_size = (sim_tx_len + count) * 2;
+        sim_tx = (float *)realloc(sim_tx, sim_tx_size * sizeof(float));
+
+        if (sim_tx == NULL)
+        {
+            fprintf(stderr, "channel_sim: Out of memory for transmit audio\n");
+            exit(1);
+        }
+    }
+
+    memcpy(&sim_tx[sim_tx_len], samples, count * sizeof(float));
+    sim_tx_len += count;
+}
+
+static int sim_read(float samples[], int count)
+{
+    return -1;
+}
+
+static int sim_open(struct audio_s *pa)
+{
+    return 0;
+}
+
+static int sim_period_frames()
+{
+    return 960;
+}
+
+static void sim_nothing()
+{
+}
+
+static const struct audio_backend_s sim_backend = {
+    .name = "simulator",
+    .realtime = false,
+    .open = sim_open,
+    .read = sim_read,
+    .period_frames = sim_period_frames,
+    .write = sim_write,
+    .flush = sim_nothing,
+    .wait = sim_nothing,
+    .close = sim_nothing,
+};
+
+/*
+ * xorshift64*, repeatable across platforms
+ */
+static double uniform()
+{
+    prng ^= prng >> 12;
+    prng ^= prng << 25;
+    prng ^= prng >> 27;
+
+    return ((prng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static float gaussian()
+{
+    double u1 = uniform();
+    double u2 = uniform();
+
+    if (u1 < 1e-300)
+        u1 = 1e-300;
+
+    return (float)(sqrt(-2.0 * log(u1)) * cos(TAU * u2));
+}
+
+/*
+ * Blackman windowed Hilbert transformer, for
+ * shifting the real passband signal in frequency
+ */
+static void hilbert_make()
+{
+    int mid = HILBERT_TAPS / 2;
+
+    for (int i = 0; i < HILBERT_TAPS; i++)
+    {
+        int k = i - mid;
+        double w = 0.42 - 0.5 * cos(TAU * i / (HILBERT_TAPS - 1)) + 0.08 * cos(2.0 * TAU * i / (HILBERT_TAPS - 1));
+
+        hilbert[i] = (k & 1) ? (float)((2.0 / (M_PI * k)) * w) : 0.0f;
+    }
+}
+
+/*
+ * 4 point Lagrange interpolation at in[n + mu], 0 <= mu < 1
+ */
+static float lagrange(const float *in, int len, int n, float mu)
+{
+    float x[4];
+
+    for (int k = 0; k < 4; k++)
+    {
+        int i = n - 1 + k;
+
+        x[k] = (i >= 0 && i < len) ? in[i] : 0.0f;
+    }
+
+    float c0 = -mu * (mu - 1.0f) * (mu - 2.0f) / 6.0f;
+    float c1 = (mu + 1.0f) * (mu - 1.0f) * (mu - 2.0f) / 2.0f;
+    float c2 = -(mu + 1.0f) * mu * (mu - 2.0f) / 2.0f;
+    float c3 = (mu + 1.0f) * mu * (mu - 1.0f) / 6.0f;
+
+    return c0 * x[0] + c1 * x[1] + c2 * x[2] + c3 * x[3];
+}
+
+/*
+ * Run one burst of transmit audio through the channel
+ *
+ * Returns the received length, out is allocated
+ * here and rounded up to a multiple of CYCLES.
+ */
+static int channel_apply(const struct channel_s *ch, const float *in, int len, float **out, float sigma)
+{
+    float *a = (float *)malloc(len * sizeof(float));
+    int mid = HILBERT_TAPS / 2;
+
+    /*
+     * Two-path
+     */
+    for (int i = 0; i < len; i++)
+    {
+        a[i] = in[i];
+
+        if (ch->mp_gain != 0.0f && i >= ch->mp_delay)
+        {
+            a[i] += ch->mp_gain * in[i - ch->mp_delay];
+        }
+    }
+
+    /*
+     * Carrier offset, as a single sideband shift
+     */
+    if (ch->cfo != 0.0f)
+    {
+        float *b = (float *)malloc(len * sizeof(float));
+        double step = TAU * ch->cfo / FS;
+
+        for (int i = 0; i < len; i++)
+        {
+            float q = 0.0f;
+
+            for (int k = 0; k < HILBERT_TAPS; k++)
+            {
+                int j = i + mid - k;
+
+                if (j >= 0 && j < len)
+                    q += hilbert[k] * a[j];
+            }
+
+            b[i] = a[i] * (float)cos(cfo_phase) - q * (float)sin(cfo_phase);
+
+            cfo_phase = fmod(cfo_phase + step, TAU);
+        }
+
+        free(a);
+        a = b;
+    }
+
+    /*
+     * Sample clock error, resample by 1 + ppm
+     */
+    double ratio = 1.0 + ch->ppm * 1e-6;
+    int rlen = (int)(len / ratio);
+
+    rlen = ((rlen + CYCLES - 1) / CYCLES) * CYCLES;
+
+    float *r = (float *)malloc(rlen * sizeof(float));
+
+    for (int m = 0; m < rlen; m++)
+    {
+        double t = m * ratio;
+        int n = (int)t;
+
+        r[m] = lagrange(a, len, n, (float)(t - n));
+    }
+
+    free(a);
+
+    /*
+     * AWGN
+     */
+    for (int m = 0; m < rlen; m++)
+    {
+        r[m] += sigma * gaussian();
+    }
+
+    *out = r;
+
+    return rlen;
+}
+
+static bool parse_spec(const char *spec, struct channel_s *ch, float *start, float *stop, float *step, int *frames, int *len, int *txdelay)
+{
+    char buf[200];
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char *t = strtok(buf, ","); t != NULL; t = strtok(NULL, ","))
+    {
+        char *v = strchr(t, '=');
+
+        if (v == NULL)
+        {
+            fprintf(stderr, "Simulator: Expected key=value, got %s\n", t);
+            return false;
+        }
+
+        *v++ = '\0';
+
+        if (strcasecmp(t, "ebn0") == 0)
+        {
+            int n = sscanf(v, "%f:%f:%f", start, stop, step);
+
+            if (n < 1)
+                return false;
+
+            if (n == 1)
+                *stop = *start;
+        }
+        else if (strcasecmp(t, "n") == 0)
+        {
+            *frames = atoi(v);
+        }
+        else if (strcasecmp(t, "len") == 0)
+        {
+            *len = atoi(v);
+        }
+        else if (strcasecmp(t, "cfo") == 0)
+        {
+            ch->cfo = atof(v);
+        }
+        else if (strcasecmp(t, "ppm") == 0)
+        {
+            ch->ppm = atof(v);
+        }
+        else if (strcasecmp(t, "mp") == 0)
+        {
+            if (sscanf(v, "%f:%d", &ch->mp_gain, &ch->mp_delay) < 1)
+                return false;
+        }
+        else if (strcasecmp(t, "seed") == 0)
+        {
+            ch->seed = strtoul(v, NULL, 0);
+        }
+        else if (strcasecmp(t, "txdelay") == 0)
+        {
+            *txdelay = atoi(v);
+        }
+        else
+        {
+            fprintf(stderr, "Simulator: Unknown key %s\n", t);
+            return false;
+        }
+    }
+
+    if (*frames < 1 || *len < 1 || *len > IL2P_MAX_PAYLOAD_SIZE || *step <= 0.0f || ch->mp_delay < 0 || *txdelay < 0)
+    {
+        fprintf(stderr, "Simulator: Parameter out of range\n");
+        return false;
+    }
+
+    return true;
+}
+
+static double cpu_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Everything the node would set up,
+ * minus the audio device and threads
+ */
+static void modem_reset()
+{
+    create_control_loop((TAU / 180.0f), -1.0f, 1.0f);
+    create_freq_acq();
+    create_timing_error_detector();
+    create_symbol_sync((float)CYCLES, SYMSYNC_LOOP_BW, SYMSYNC_DAMPING, SYMSYNC_MAX_DEV);
+
+    tx_reset();
+    rx_reset();
+}
+
+int channel_sim_run(struct audio_s *pa, const char *spec)
+{
+    struct channel_s ch;
+    float start = 0.0f, stop = 14.0f, step = 2.0f;
+    int frames = 100;
+    int len = 64;
+    int txdelay_10ms = pa->txdelay;
+
+    memset(&ch, 0, sizeof(ch));
+    ch.seed = 1UL;
+
+    if (spec != NULL && parse_spec(spec, &ch, &start, &stop, &step, &frames, &len, &txdelay_10ms) == false)
+    {
+        return 1;
+    }
+
+    createQPSKConstellation();
+    rrc_make(FS, RS, .35f);
+    rx_queue_init();
+    il2p_init();
+    hilbert_make();
+
+    audio_set_backend(&sim_backend);
+
+    char addrs[AX25_ADDRS][AX25_MAX_ADDR_LEN];
+    uint8_t info[AX25_MAX_INFO_LEN];
+    uint8_t sent[AX25_MAX_PACKET_LEN];
+    uint8_t got[AX25_MAX_PACKET_LEN];
+
+    memset(addrs, 0, sizeof(addrs));
+    strlcpy(addrs[0], "W1AW-1", sizeof(addrs[0]));
+    strlcpy(addrs[1], pa->mycall, sizeof(addrs[1]));
+
+    int gap = (int)(FS * GAP_MS / 1000.0);
+    int txdelay = MS_TO_FLAGS(txdelay_10ms * 10);
+    int txtail = MS_TO_FLAGS(pa->txtail * 10);
+
+    fprintf(stderr, "RRC filter using %s kernel\n", rrc_fir_kernel_name());
+
+    printf("Channel: CFO %.1f Hz, clock %.1f ppm, ", ch.cfo, ch.ppm);
+
+    if (ch.mp_gain != 0.0f)
+        printf("second path %.2f at %d samples\n", ch.mp_gain, ch.mp_delay);
+    else
+        printf("single path\n");
+
+    printf("%d frames of %d info bytes per point, TXDELAY %d, TXTAIL %d\n\n", frames, len, txdelay_10ms, pa->txtail);
+    printf("Lost frames by where they failed: no sync word, header FEC, payload FEC\n\n");
+    printf("Eb/N0 dB  Frames    Good   Bad    Sync  Header  Payload     PER\n");
+
+    double rx_cpu = 0.0;
+    double tx_cpu = 0.0;
+    double audio = 0.0;
+
+    for (float ebn0 = start; ebn0 <= stop + (step / 2.0f); ebn0 += step)
+    {
+        int good = 0;
+        int bad = 0;
+        int sync_miss = 0;
+        int header_fail = 0;
+        int payload_fail = 0;
+
+        prng = ch.seed * 0x9E3779B97F4A7C15ULL + (uint64_t)((ebn0 + 100.0f) * 1000.0f);
+        cfo_phase = 0.0;
+
+        modem_reset();
+
+        for (int f = 0; f < frames; f++)
+        {
+            for (int i = 0; i < len; i++)
+            {
+                info[i] = (uint8_t)(uniform() * 256.0);
+            }
+
+            packet_t pp = ax25_u_frame(addrs, cr_cmd, frame_type_U_UI, 0, 0xF0, info, len);
+
+            if (pp == NULL)
+            {
+                return 1;
+            }
+
+            int slen = ax25_pack(pp, sent);
+
+            /*
+             * Quiet, preamble, frame, tail
+             */
+            sim_tx_len = 0;
+
+            float silence[CYCLES * 8];
+
+            memset(silence, 0, sizeof(silence));
+
+            for (int i = 0; i < gap; i += (CYCLES * 8))
+            {
+                sim_write(silence, CYCLES * 8);
+            }
+
+            int quiet = sim_tx_len;
+
+            double t0 = cpu_seconds();
+
+            il2p_send_idle(txdelay);
+            il2p_send_frame(pp);
+            il2p_send_idle(txtail);
+
+            tx_cpu += cpu_seconds() - t0;
+
+            ax25_delete(pp);
+
+            /*
+             * Noise is scaled to the burst power
+             */
+            double power = 0.0;
+
+            for (int i = quiet; i < sim_tx_len; i++)
+            {
+                power += (double)sim_tx[i] * sim_tx[i];
+            }
+
+            power /= (sim_tx_len - quiet);
+
+            double ebn0_lin = pow(10.0, ebn0 / 10.0);
+            float sigma = (float)sqrt(power * FS / (2.0 * RS * BITS_PER_SYMBOL * ebn0_lin));
+
+            float *rx;
+            int rlen = channel_apply(&ch, sim_tx, sim_tx_len, &rx, sigma);
+
+            struct il2p_rec_stats_s before, after;
+
+            il2p_rec_get_stats(&before);
+
+            t0 = cpu_seconds();
+
+            rx_process_block(rx, rlen);
+
+            rx_cpu += cpu_seconds() - t0;
+            audio += rlen / FS;
+
+            free(rx);
+
+            /*
+             * Count what came out the other end
+             */
+            struct rx_queue_item_s *pitem;
+            bool found = false;
+
+            while ((pitem = rx_queue_remove()) != NULL)
+            {
+                if (pitem->type == RXQ_REC_FRAME && pitem->pp != NULL)
+                {
+                    int glen = ax25_pack(pitem->pp, got);
+
+                    if (glen == slen && memcmp(got, sent, slen) == 0 && found == false)
+                    {
+                        found = true;
+                    }
+                    else
+                    {
+                        bad++; // a frame, but not this one
+                    }
+                }
+
+                rx_queue_delete(pitem);
+            }
+
+            il2p_rec_get_stats(&after);
+
+            /*
+             * A lost frame either never showed its sync word, or
+             * failed in the header or payload after it. A false
+             * sync in the noise gap counts as no sync.
+             */
+            if (found == true)
+                good++;
+            else if (after.payload_fails > before.payload_fails)
+                payload_fail++;
+            else if (after.header_fails > before.header_fails && after.syncs > before.syncs)
+                header_fail++;
+            else
+                sync_miss++;
+        }
+
+        printf("%8.1f  %6d  %6d  %4d  %6d  %6d  %7d  %6.3f\n", ebn0, frames, good, bad,
+               sync_miss, header_fail, payload_fail, (double)(frames - good) / frames);
+        fflush(stdout);
+    }
+
+    printf("\nRX DSP %.2f ms CPU per second of audio, %.0f times real time\n",
+           (audio > 0.0) ? rx_cpu * 1000.0 / audio : 0.0, (rx_cpu > 0.0) ? audio / rx_cpu : 0.0);
+    printf("TX DSP %.2f ms CPU per second of audio\n", (audio > 0.0) ? tx_cpu * 1000.0 / audio : 0.0);
+
+    free(sim_tx);
+    sim_tx = NULL;
+    sim_tx_size = 0;
+
+    return 0;
+}
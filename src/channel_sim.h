@@ -0,0 +1,38 @@
+/*
+ * channel_sim.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "audio.h"
+
+    /*
+     * Channel impairments applied between
+     * the modulator and the demodulator
+     */
+    struct channel_s
+    {
+        float ebn0;     // dB, AWGN
+        float cfo;      // Hz, carrier frequency offset
+        float ppm;      // sample clock error, > 0 transmitter runs fast
+        float mp_gain;  // second path gain, 0 for none
+        int mp_delay;   // second path delay in samples
+        unsigned long seed;
+    };
+
+    int channel_sim_run(struct audio_s *, const char *);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <sched.h>
 #include <bsd/bsd.h>
 
 #include "ipnode.h"
@@ -199,6 +200,24 @@ static char *split(char *string)
     return t;
 }
 
+/*
+ * Thread name used by SCHED and CPU commands
+ */
+static int thread_type(const char *name)
+{
+    static const char *names[NUM_THTYPES] = {"RX", "CAPTURE", "TX", "KISS", "LINK"};
+
+    for (int th = 0; th < NUM_THTYPES; th++)
+    {
+        if (strcasecmp(name, names[th]) == 0)
+        {
+            return th;
+        }
+    }
+
+    return -1;
+}
+
 void config_init(char *fname, struct audio_s *p_audio_config, struct misc_config_s *p_misc_config)
 {
     /*
@@ -224,12 +243,22 @@ void config_init(char *fname, struct audio_s *p_audio_config, struct misc_config
         p_audio_config->ictrl[it].inh_invert = 0;
     }
 
+    for (int th = 0; th < NUM_THTYPES; th++)
+    {
+        p_audio_config->sched[th].policy = SCHED_OTHER;
+        p_audio_config->sched[th].priority = 0;
+        p_audio_config->sched[th].cpu = -1;
+    }
+
     p_audio_config->dwait = DEFAULT_DWAIT;
     p_audio_config->slottime = DEFAULT_SLOTTIME;
     p_audio_config->persist = DEFAULT_PERSIST;
     p_audio_config->txdelay = DEFAULT_TXDELAY;
     p_audio_config->txtail = DEFAULT_TXTAIL;
     p_audio_config->fulldup = DEFAULT_FULLDUP;
+    p_audio_config->mmap = DEFAULT_MMAP;
+    p_audio_config->rxring = DEFAULT_RXRING;
+    p_audio_config->mlockall = DEFAULT_MLOCKALL;
 
     strlcpy(p_audio_config->mycall, "NOCALL", 6);
 
@@ -633,6 +662,173 @@ void config_init(char *fname, struct audio_s *p_audio_config, struct misc_config
             }
         }
 
+        /*
+         * MMAP  {on|off} 		- Soundcard DMA ring accessed directly
+         */
+        else if (strcasecmp(t, "MMAP") == 0)
+        {
+            t = split(NULL);
+
+            if (t == NULL)
+            {
+                printf("Line %d: Missing parameter for MMAP command.  Expecting ON or OFF.\n", line);
+                continue;
+            }
+
+            if (strcasecmp(t, "ON") == 0)
+            {
+                p_audio_config->mmap = 1;
+            }
+            else if (strcasecmp(t, "OFF") == 0)
+            {
+                p_audio_config->mmap = 0;
+            }
+            else
+            {
+                p_audio_config->mmap = 0;
+
+                printf("Line %d: Expected ON or OFF for MMAP.\n", line);
+            }
+        }
+
+        /*
+         * RXRING n		- Receive sample ring depth. n = mS of audio.
+         */
+
+        else if (strcasecmp(t, "RXRING") == 0)
+        {
+            t = split(NULL);
+
+            if (t == NULL)
+            {
+                printf("Line %d: Missing depth for RXRING command.\n", line);
+                continue;
+            }
+
+            int n = atoi(t);
+
+            if (n >= 50 && n <= 10000)
+            {
+                p_audio_config->rxring = n;
+            }
+            else
+            {
+                p_audio_config->rxring = DEFAULT_RXRING;
+
+                printf("Line %d: Invalid depth for RXRING, 50 to 10000 mS. Using %d.\n",
+                       line, p_audio_config->rxring);
+            }
+        }
+
+        /*
+         * SCHED thread {FIFO|RR|OTHER} [priority]	- Thread scheduling policy.
+         * CPU   thread n				- Pin thread to CPU n.
+         *
+         * thread is RX, CAPTURE, TX, KISS, or LINK
+         */
+
+        else if (strcasecmp(t, "SCHED") == 0 || strcasecmp(t, "CPU") == 0)
+        {
+            char cmd[8];
+
+            strlcpy(cmd, t, sizeof(cmd));
+
+            t = split(NULL);
+
+            if (t == NULL)
+            {
+                printf("Line %d: Missing thread name for %s command.\n", line, cmd);
+                continue;
+            }
+
+            int th = thread_type(t);
+
+            if (th < 0)
+            {
+                printf("Line %d: Unknown thread %s for %s. Expecting RX, CAPTURE, TX, KISS, or LINK.\n", line, t, cmd);
+                continue;
+            }
+
+            t = split(NULL);
+
+            if (t == NULL)
+            {
+                printf("Line %d: Missing parameter for %s command.\n", line, cmd);
+                continue;
+            }
+
+            if (strcasecmp(cmd, "CPU") == 0)
+            {
+                p_audio_config->sched[th].cpu = atoi(t);
+                continue;
+            }
+
+            if (strcasecmp(t, "FIFO") == 0)
+            {
+                p_audio_config->sched[th].policy = SCHED_FIFO;
+            }
+            else if (strcasecmp(t, "RR") == 0)
+            {
+                p_audio_config->sched[th].policy = SCHED_RR;
+            }
+            else if (strcasecmp(t, "OTHER") == 0)
+            {
+                p_audio_config->sched[th].policy = SCHED_OTHER;
+                p_audio_config->sched[th].priority = 0;
+                continue;
+            }
+            else
+            {
+                printf("Line %d: Expected FIFO, RR, or OTHER for SCHED.\n", line);
+                continue;
+            }
+
+            t = split(NULL);
+
+            int n = (t == NULL) ? DEFAULT_RTPRIO : atoi(t);
+
+            if (n >= 1 && n <= 99)
+            {
+                p_audio_config->sched[th].priority = n;
+            }
+            else
+            {
+                p_audio_config->sched[th].priority = DEFAULT_RTPRIO;
+
+                printf("Line %d: Invalid priority for SCHED, 1 to 99. Using %d.\n",
+                       line, p_audio_config->sched[th].priority);
+            }
+        }
+
+        /*
+         * MLOCKALL  {on|off} 		- Lock all memory, so page faults can't stall audio
+         */
+        else if (strcasecmp(t, "MLOCKALL") == 0)
+        {
+            t = split(NULL);
+
+            if (t == NULL)
+            {
+                printf("Line %d: Missing parameter for MLOCKALL command.  Expecting ON or OFF.\n", line);
+                continue;
+            }
+
+            if (strcasecmp(t, "ON") == 0)
+            {
+                p_audio_config->mlockall = 1;
+            }
+            else if (strcasecmp(t, "OFF") == 0)
+            {
+                p_audio_config->mlockall = 0;
+            }
+            else
+            {
+                p_audio_config->mlockall = 0;
+
+                printf("Line %d: Expected ON or OFF for MLOCKALL.\n", line);
+            }
+        }
+
         /*
          * FRACK  n 		- Number of seconds to wait for ack to transmission.
          */
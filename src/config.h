@@ -30,6 +30,10 @@ extern "C"
 #define DEFAULT_TXDELAY 10
 #define DEFAULT_TXTAIL 10
 #define DEFAULT_FULLDUP 0
+#define DEFAULT_MMAP 0
+#define DEFAULT_RXRING 500
+#define DEFAULT_MLOCKALL 0
+#define DEFAULT_RTPRIO 50
 
     struct misc_config_s
     {
@@ -39,3 +39,16 @@ uint8_t qpskToDiBit(complex float sample)
     // Imag component determines big bit.
     return 2 * (cimagf(sample) > 0.0f) + (crealf(sample) > 0.0f);
 }
+
+/*
+ * The dibit qpskToDiBit() returns for a symbol once the
+ * carrier phase has moved a further quarter turn. The
+ * Costas loop locks at any of the four, so the receiver
+ * sees the transmitted dibits through 0 to 3 of these.
+ */
+uint8_t qpskRotateDiBit(uint8_t diBit)
+{
+    static const uint8_t turn[4] = { 1, 3, 0, 2 };
+
+    return turn[diBit & 0x3];
+}
@@ -20,6 +20,7 @@ void createQPSKConstellation(void);
 complex float *getQPSKConstellation(void);
 complex float getQPSKQuadrant(uint8_t);
 uint8_t qpskToDiBit(complex float);
+uint8_t qpskRotateDiBit(uint8_t);
 
 #ifdef __cplusplus
 }
@@ -28,6 +28,25 @@ static float d_loop_bw;
 static float d_alpha;
 static float d_beta;
 
+/*
+ * One cycle of cos and sin, with a guard entry so the
+ * interpolation never wraps the index. Read by phasor().
+ */
+float phasor_cos[PHASOR_TABLE + 1];
+float phasor_sin[PHASOR_TABLE + 1];
+static bool d_table_made;
+
+static void make_phasor_table() {
+    for (int i = 0; i <= PHASOR_TABLE; i++) {
+        double angle = (TAU * i) / PHASOR_TABLE;
+
+        phasor_cos[i] = (float) cos(angle);
+        phasor_sin[i] = (float) sin(angle);
+    }
+
+    d_table_made = true;
+}
+
 /*
  * A Costas loop carrier recovery algorithm.
  *
@@ -35,6 +54,9 @@ static float d_beta;
  * downconverts signal to baseband.
  */
 void create_control_loop(float loop_bw, float min_freq, float max_freq) {
+    if (d_table_made == false)
+        make_phasor_table();
+
     set_phase(0.0f);
     set_frequency(0.0f);
 
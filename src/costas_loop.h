@@ -15,8 +15,16 @@ extern "C"
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <complex.h>
 
+#include "ipnode.h"
+
+#define PHASOR_TABLE 512 // power of two
+
+extern float phasor_cos[];
+extern float phasor_sin[];
+
 void create_control_loop(float, float, float);
 float phase_detector(complex float);
 void advance_loop(float);
@@ -45,6 +53,48 @@ float get_phase(void);
 float get_max_freq(void);
 float get_min_freq(void);
 
+/*
+ * exp(j * phase) from a table, linearly interpolated, to
+ * replace cmplx(). Inline, as a complex float returned from
+ * a call goes through memory.
+ *
+ * With PHASOR_TABLE 512 the amplitude is within 2e-5 and
+ * the phase within 1e-6 rad, against about 3e-2 rad of noise
+ * on a symbol at 30 dB SNR. ipnode -Bphasor measures it.
+ */
+static inline complex float phasor(float phase)
+{
+    /*
+     * Fixed point, 16 bits of fraction between entries. The
+     * mask gives the floor for negative phase too, and any
+     * phase_wrap() range fits easily.
+     */
+    int32_t x = (int32_t)(phase * (float)((PHASOR_TABLE * 65536.0) / TAU));
+    int i = (x >> 16) & (PHASOR_TABLE - 1);
+    float frac = (float)(x & 0xFFFF) * (1.0f / 65536.0f);
+
+    float c = phasor_cos[i] + frac * (phasor_cos[i + 1] - phasor_cos[i]);
+    float s = phasor_sin[i] + frac * (phasor_sin[i + 1] - phasor_sin[i]);
+
+    return CMPLXF(c, s);
+}
+
+/*
+ * Remove the loop phase from a symbol, sample * exp(-j * phase)
+ *
+ * Written out so it compiles to four multiplies,
+ * without the C99 complex multiply NaN checks
+ */
+static inline complex float derotate(complex float sample)
+{
+    complex float p = phasor(get_phase());
+
+    float re = crealf(sample);
+    float im = cimagf(sample);
+
+    return CMPLXF((re * crealf(p)) + (im * cimagf(p)), (im * crealf(p)) - (re * cimagf(p)));
+}
+
 #ifdef __cplusplus
 }
 #endif
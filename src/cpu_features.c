@@ -0,0 +1,59 @@
+/*
+ * cpu_features.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdbool.h>
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "cpu_features.h"
+
+static unsigned int features;
+static bool probed = false;
+
+/*
+ * Runtime probe of the vector units, so one binary
+ * can pick the fastest DSP kernels for the host.
+ *
+ * Called at init time, before any threads start.
+ */
+unsigned int cpu_features()
+{
+    if (probed == true)
+    {
+        return features;
+    }
+
+    features = 0U;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+        features |= CPU_SSE2;
+
+    if (__builtin_cpu_supports("ssse3"))
+        features |= CPU_SSSE3;
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        features |= CPU_AVX2;
+#elif defined(__aarch64__)
+    features |= CPU_NEON; // Advanced SIMD is mandatory on ARMv8
+#elif defined(__arm__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+        features |= CPU_NEON;
+#endif
+
+    probed = true;
+
+    return features;
+}
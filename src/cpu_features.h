@@ -0,0 +1,27 @@
+/*
+ * cpu_features.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CPU_SSE2 0x01
+#define CPU_SSSE3 0x02
+#define CPU_AVX2 0x04 // includes FMA
+#define CPU_NEON 0x08
+
+    unsigned int cpu_features(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+/*
+ * dcd.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Data carrier detect
+ *
+ * Each derotated symbol is compared with the nearest point of
+ * the constellation the Costas loop locks to (the diagonals),
+ * scaled to the average symbol amplitude. The error vector and
+ * signal powers are averaged, and their ratio is the EVM.
+ *
+ * Noise alone gives an EVM of about .75, a clean signal near
+ * zero. DCD comes on after DCD_ATTACK symbols in a row under
+ * DCD_ON_EVM, and goes off after DCD_DECAY symbols in a row over
+ * DCD_OFF_EVM, so a short fade in a frame doesn't drop it.
+ */
+
+#include <stdbool.h>
+#include <complex.h>
+#include <math.h>
+
+#include "dcd.h"
+
+static float d_amplitude;   // average |re| and |im|
+static float d_signal;      // average ideal point power
+static float d_error;       // average error vector power
+
+static int d_run;           // symbols in a row past the threshold
+static bool d_dcd;
+
+void dcd_reset()
+{
+    d_amplitude = 0.0f;
+    d_signal = 0.0f;
+    d_error = 0.0f;
+    d_run = 0;
+    d_dcd = false;
+}
+
+/*
+ * One symbol after the Costas loop
+ *
+ * Returns true when DCD changed.
+ */
+bool dcd_input(complex float symbol)
+{
+    float re = crealf(symbol);
+    float im = cimagf(symbol);
+
+    d_amplitude += DCD_SMOOTH * (((fabsf(re) + fabsf(im)) * 0.5f) - d_amplitude);
+
+    /*
+     * Nearest diagonal point at the average amplitude
+     */
+    float ire = (re < 0.0f) ? -d_amplitude : d_amplitude;
+    float iim = (im < 0.0f) ? -d_amplitude : d_amplitude;
+    float ere = re - ire;
+    float eim = im - iim;
+
+    d_signal += DCD_SMOOTH * (((ire * ire) + (iim * iim)) - d_signal);
+    d_error += DCD_SMOOTH * (((ere * ere) + (eim * eim)) - d_error);
+
+    float evm = get_dcd_evm();
+    bool was = d_dcd;
+
+    if (d_dcd == false)
+    {
+        d_run = (evm < DCD_ON_EVM) ? (d_run + 1) : 0;
+
+        if (d_run >= DCD_ATTACK)
+        {
+            d_dcd = true;
+            d_run = 0;
+        }
+    }
+    else
+    {
+        d_run = (evm > DCD_OFF_EVM) ? (d_run + 1) : 0;
+
+        if (d_run >= DCD_DECAY)
+        {
+            d_dcd = false;
+            d_run = 0;
+        }
+    }
+
+    return d_dcd != was;
+}
+
+bool get_dcd()
+{
+    return d_dcd;
+}
+
+/*
+ * RMS error over RMS signal, 1 or more for no signal
+ */
+float get_dcd_evm()
+{
+    if (d_signal < DCD_MIN_POWER)
+        return 1.0f;
+
+    return sqrtf(d_error / d_signal);
+}
+
+/*
+ * Symbol SNR in dB from the EVM
+ */
+float get_dcd_snr()
+{
+    float evm = get_dcd_evm();
+
+    return -20.0f * log10f((evm > 1e-3f) ? evm : 1e-3f);
+}
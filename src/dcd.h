@@ -0,0 +1,39 @@
+/*
+ * dcd.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <complex.h>
+
+#define DCD_SMOOTH (1.0f / 32.0f) // error and signal power averaging
+#define DCD_ON_EVM 0.5f           // about 6 dB SNR, noise alone reads .75
+#define DCD_OFF_EVM 0.6f
+#define DCD_ATTACK 16             // symbols below DCD_ON_EVM to turn on
+#define DCD_DECAY 64              // symbols above DCD_OFF_EVM to turn off
+#define DCD_MIN_POWER 1e-6f       // below this it is silence, not signal
+
+void dcd_reset(void);
+bool dcd_input(complex float);
+
+// Getters
+
+bool get_dcd(void);
+float get_dcd_evm(void);
+float get_dcd_snr(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+ * freq_acq.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Coarse carrier frequency acquisition
+ *
+ * The Costas loop only pulls in slowly from a large offset,
+ * and starts each burst from wherever it was left. Here the
+ * symbols before derotation are raised to the 4th power, which
+ * strips the QPSK modulation and leaves a tone at four times
+ * the offset. An FFT over ACQ_SYMBOLS symbols finds it, to
+ * +/- Pi/4 radians per symbol (150 Hz at 1200 Baud).
+ *
+ * If the tone stands well out of the noise and the loop is
+ * more than a bin away from it, the loop frequency and phase
+ * are set from the estimate, and the Costas loop takes over.
+ * A locked loop agrees with the estimate and is left alone.
+ *
+ * The receiver only feeds it while the decoder is looking
+ * for the sync word, and resets it at the start of each
+ * burst and while a frame is coming in.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <complex.h>
+#include <math.h>
+
+#include "ipnode.h"
+#include "costas_loop.h"
+#include "fft.h"
+#include "freq_acq.h"
+
+static fft_cfg d_fft;
+
+static complex float d_block[ACQ_SYMBOLS];
+static complex float d_spectrum[ACQ_SYMBOLS];
+static float d_power[ACQ_SYMBOLS];
+static int d_count;
+
+static float d_frequency; // last estimate, radians per symbol
+static int d_seeds;
+
+void create_freq_acq()
+{
+    if (d_fft == NULL)
+    {
+        d_fft = fft_alloc(ACQ_SYMBOLS, 0, NULL, NULL);
+
+        if (d_fft == NULL)
+        {
+            fprintf(stderr, "create_freq_acq: Could not allocate FFT\n");
+            exit(1);
+        }
+    }
+
+    freq_acq_reset();
+}
+
+void freq_acq_reset()
+{
+    d_count = 0;
+    d_frequency = 0.0f;
+    d_seeds = 0;
+}
+
+/*
+ * Peak bin and its parabolic fraction, returns the
+ * peak power over the mean of the rest, or 0 for none
+ */
+static float find_peak(float *bin)
+{
+    float total = 0.0f;
+    int peak = 0;
+
+    for (int i = 0; i < ACQ_SYMBOLS; i++)
+    {
+        float re = crealf(d_spectrum[i]);
+        float im = cimagf(d_spectrum[i]);
+
+        d_power[i] = (re * re) + (im * im);
+        total += d_power[i];
+
+        if (d_power[i] > d_power[peak])
+            peak = i;
+    }
+
+    float rest = (total - d_power[peak]) / (ACQ_SYMBOLS - 1);
+
+    if (rest <= 0.0f)
+        return 0.0f;
+
+    float ratio = d_power[peak] / rest;
+
+    float a = sqrtf(d_power[(peak - 1) & (ACQ_SYMBOLS - 1)]);
+    float b = sqrtf(d_power[peak]);
+    float c = sqrtf(d_power[(peak + 1) & (ACQ_SYMBOLS - 1)]);
+    float denom = a - (2.0f * b) + c;
+    float frac = (denom != 0.0f) ? (0.5f * (a - c) / denom) : 0.0f;
+
+    if (peak >= (ACQ_SYMBOLS / 2))
+        peak -= ACQ_SYMBOLS;
+
+    *bin = peak + frac;
+
+    return ratio;
+}
+
+/*
+ * One symbol from the timing loop, before derotation
+ *
+ * Returns true when the Costas loop was just seeded.
+ */
+bool freq_acq_input(complex float symbol)
+{
+    float re = crealf(symbol);
+    float im = cimagf(symbol);
+    float mag = sqrtf((re * re) + (im * im));
+
+    /*
+     * 4th power, scaled back to the symbol magnitude
+     * so strong symbols don't swamp the estimate
+     */
+    complex float sq = CMPLXF((re * re) - (im * im), 2.0f * re * im);
+    complex float quad = CMPLXF((crealf(sq) * crealf(sq)) - (cimagf(sq) * cimagf(sq)), 2.0f * crealf(sq) * cimagf(sq));
+
+    d_block[d_count++] = (mag > 1e-9f) ? quad / (mag * mag * mag) : 0.0f;
+
+    if (d_count < ACQ_SYMBOLS)
+        return false;
+
+    d_count = 0;
+
+    fft(d_fft, d_block, d_spectrum);
+
+    float bin;
+
+    if (find_peak(&bin) < ACQ_THRESHOLD)
+        return false;
+
+    /*
+     * Four times the offset, in radians per symbol
+     */
+    float w4 = (float)(TAU * bin / ACQ_SYMBOLS);
+
+    d_frequency = w4 / 4.0f;
+
+    if (fabsf(d_frequency - get_frequency()) < (float)(TAU / (4.0 * ACQ_SYMBOLS)))
+        return false;
+
+    /*
+     * Phase of the tone at the first symbol of the
+     * block, by correlating at the refined frequency
+     */
+    complex float acc = 0.0f;
+
+    for (int k = 0; k < ACQ_SYMBOLS; k++)
+    {
+        acc += d_block[k] * cmplxconj(w4 * k);
+    }
+
+    /*
+     * The loop settles with the points on the diagonals,
+     * where the 4th power is negative real. Carry the
+     * phase forward to the next symbol.
+     */
+    float phase = ((cargf(acc) - (float)M_PI) / 4.0f) + (d_frequency * ACQ_SYMBOLS);
+
+    set_frequency(d_frequency);
+    set_phase(remainderf(phase, (float)TAU));
+
+    d_seeds++;
+
+    return true;
+}
+
+/*
+ * Last estimate in radians per symbol
+ */
+float get_acq_frequency()
+{
+    return d_frequency;
+}
+
+int get_acq_count()
+{
+    return d_seeds;
+}
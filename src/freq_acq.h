@@ -0,0 +1,35 @@
+/*
+ * freq_acq.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <complex.h>
+
+#define ACQ_SYMBOLS 64      // FFT length, about 53 mS at 1200 Baud
+#define ACQ_THRESHOLD 12.0f // 4th power peak over mean bin power
+
+void create_freq_acq(void);
+void freq_acq_reset(void);
+bool freq_acq_input(complex float);
+
+// Getters
+
+float get_acq_frequency(void);
+int get_acq_count(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "audio.h"
 #include "ax25_pad.h"
@@ -47,21 +48,33 @@ extern "C"
     {
         IL2P_SEARCHING = 0,
         IL2P_HEADER,
-        IL2P_PAYLOAD,
-        IL2P_DECODE
+        IL2P_PAYLOAD
     };
 
     struct il2p_context_s
     {
         enum il2p_s state;
-        unsigned int acc;
-        int bc;
-        int hc;
-        int eplen;
-        int pc;
-        uint8_t shdr[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY];
+        unsigned int acc;  // last 12 dibits while searching
+        int turns;         // quarter turns of carrier phase found with the sync word
+        int dc;            // dibits so far in this byte
+        unsigned int cur;  // the byte being gathered
+        float bconf;       // weakest bit so far in this byte
+        int len;           // bytes gathered
+        int need;          // bytes wanted before the next step
         uint8_t uhdr[IL2P_HEADER_SIZE];
-        uint8_t spayload[IL2P_MAX_ENCODED_PAYLOAD_SIZE];
+        uint8_t frame[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY + IL2P_MAX_ENCODED_PAYLOAD_SIZE];
+        float conf[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY + IL2P_MAX_ENCODED_PAYLOAD_SIZE];
+    };
+
+    /*
+     * Running counts of how far frames got
+     */
+    struct il2p_rec_stats_s
+    {
+        unsigned long syncs;         // sync words found
+        unsigned long header_fails;  // header failed FEC or made no sense
+        unsigned long payload_fails; // payload failed FEC
+        unsigned long frames;        // frames passed on
     };
 
     typedef struct
@@ -102,28 +115,43 @@ extern "C"
         return x;
     }
 
-    void encode_rs_char(struct rs *, uint8_t *, uint8_t *);
-    int decode_rs_char(struct rs *, uint8_t *, int *, int);
+    void encode_rs_char(struct rs *, uint8_t *, int, uint8_t *);
+    int decode_rs_char(struct rs *, uint8_t *, int, int *, int);
+
+    void il2p_gf_init(struct rs *);
+    const char *il2p_gf_kernel_name(void);
+    void rs_syndromes(struct rs *, const uint8_t *, int, uint8_t *);
+    void rs_syndromes_scalar(struct rs *, const uint8_t *, int, uint8_t *);
+    void rs_parity(struct rs *, const uint8_t *, int, uint8_t *);
+    void rs_parity_scalar(struct rs *, const uint8_t *, int, uint8_t *);
 
     void il2p_init(void);
     struct rs *il2p_find_rs(int);
     void il2p_encode_rs(uint8_t *, int, int, uint8_t *);
-    int il2p_decode_rs(uint8_t *, int, int, uint8_t *);
+    int il2p_decode_rs(uint8_t *, const float *, int, int, uint8_t *);
     struct rs *init_rs_char(unsigned int, unsigned int, unsigned int, unsigned int);
-    void il2p_rec_bit(int);
+    void il2p_rec_init(void);
+    void il2p_rec_reset(void);
+    bool il2p_rec_searching(void);
+    void il2p_rec_get_stats(struct il2p_rec_stats_s *);
+    void il2p_rec_dibit(int, float, float);
+    void il2p_rec_bytes(const uint8_t[], const float[], int);
     int il2p_send_frame(packet_t);
     void il2p_send_idle(int);
     int il2p_encode_frame(packet_t, uint8_t *);
     packet_t il2p_decode_frame(uint8_t *);
-    packet_t il2p_decode_header_payload(uint8_t *, uint8_t *, int *);
+    packet_t il2p_decode_header_payload(uint8_t *, uint8_t *, const float *, int *);
     int il2p_type_1_header(packet_t, uint8_t *);
     packet_t il2p_decode_header_type_1(uint8_t *, int);
-    int il2p_clarify_header(uint8_t *, uint8_t *);
+    int il2p_clarify_header(uint8_t *, const float *, uint8_t *);
+    void il2p_scramble_init(void);
     void il2p_scramble_block(uint8_t *, uint8_t *, int);
     void il2p_descramble_block(uint8_t *, uint8_t *, int);
+    void il2p_scramble_block_bits(uint8_t *, uint8_t *, int);
+    void il2p_descramble_block_bits(uint8_t *, uint8_t *, int);
     int il2p_payload_compute(il2p_payload_properties_t *, int);
     int il2p_encode_payload(uint8_t *, int, uint8_t *);
-    int il2p_decode_payload(uint8_t *, int, uint8_t *, int *);
+    int il2p_decode_payload(uint8_t *, const float *, int, uint8_t *, int *);
     int il2p_get_header_attributes(uint8_t *);
 
 #ifdef __cplusplus
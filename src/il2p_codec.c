@@ -59,12 +59,16 @@ int il2p_encode_frame(packet_t pp, uint8_t *iout)
 packet_t il2p_decode_frame(uint8_t *irec)
 {
     uint8_t uhdr[IL2P_HEADER_SIZE];
-    int e = il2p_clarify_header(irec, uhdr);
+    int e = il2p_clarify_header(irec, NULL, uhdr);
 
-    return il2p_decode_header_payload(uhdr, irec + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY, &e);
+    return il2p_decode_header_payload(uhdr, irec + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY, NULL, &e);
 }
 
-packet_t il2p_decode_header_payload(uint8_t *uhdr, uint8_t *epayload, int *symbols_corrected)
+/*
+ * econf is the confidence of each encoded payload
+ * byte, for erasure decoding, or NULL
+ */
+packet_t il2p_decode_header_payload(uint8_t *uhdr, uint8_t *epayload, const float *econf, int *symbols_corrected)
 {
     int payload_len = il2p_get_header_attributes(uhdr);
 
@@ -80,7 +84,7 @@ packet_t il2p_decode_header_payload(uint8_t *uhdr, uint8_t *epayload, int *symbo
         // This is the AX.25 Information part.
 
         uint8_t extracted[IL2P_MAX_PAYLOAD_SIZE];
-        int e = il2p_decode_payload(epayload, payload_len, extracted, symbols_corrected);
+        int e = il2p_decode_payload(epayload, econf, payload_len, extracted, symbols_corrected);
 
         // It would be possible to have a good header but too many errors in the payload.
 
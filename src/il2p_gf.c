@@ -0,0 +1,401 @@
+/*
+ * il2p_gf.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * GF(256) kernels for the Reed-Solomon syndromes and parity
+ *
+ * Any byte times a constant c is c * (low nibble) xor
+ * c * (high nibble << 4). Both are 16 entry tables, so a
+ * byte shuffle (PSHUFB or TBL) multiplies 16 bytes by c at
+ * once. The tables for every c take 8 KB.
+ *
+ * The encoder keeps all 16 parity bytes in one register.
+ * Each data byte shifts it along one byte and adds the
+ * feedback times the generator, which is the generator
+ * multiplied by the one feedback byte.
+ *
+ * The syndromes are worked 16 data bytes at a time. Lane k
+ * of the sum for root a gathers bytes k, k + 16, k + 32...
+ * multiplying by a^16 each step, and the 16 lanes are
+ * folded into the syndrome at the end.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "ipnode.h"
+#include "il2p.h"
+#include "cpu_features.h"
+
+#define GF_LANES 16 // most roots the vector kernels take
+
+typedef void (*gf_kernel_t)(struct rs *, const uint8_t *, int, uint8_t *);
+
+static uint8_t mul_lo[256][16] __attribute__((aligned(16))); // c * n
+static uint8_t mul_hi[256][16] __attribute__((aligned(16))); // c * (n << 4)
+
+static gf_kernel_t syndrome_kernel;
+static gf_kernel_t parity_kernel;
+static const char *gf_kernel_name;
+
+static inline uint8_t gf_mul(uint8_t c, uint8_t x)
+{
+    return mul_lo[c][x & 0x0f] ^ mul_hi[c][x >> 4];
+}
+
+/*
+ * Syndrome roots a = alpha^((fcr + i) * prim) and their
+ * 16th powers, the step between chunks
+ */
+static void root_powers(struct rs *rs, uint8_t root[], uint8_t root16[])
+{
+    for (int i = 0; i < rs->nroots; i++)
+    {
+        unsigned int e = modnn(rs, (rs->fcr + i) * rs->prim);
+
+        root[i] = rs->alpha_to[e];
+        root16[i] = rs->alpha_to[modnn(rs, e * 16U)];
+    }
+}
+
+/*
+ * Generator coefficients in poly form, in the order the
+ * parity register holds them, zero past nroots
+ */
+static void parity_generator(struct rs *rs, uint8_t gen[GF_LANES])
+{
+    memset(gen, 0, GF_LANES);
+
+    for (int k = 0; k < rs->nroots; k++)
+    {
+        gen[k] = rs->alpha_to[rs->genpoly[rs->nroots - 1 - k]];
+    }
+}
+
+/*
+ * Fold the lanes of one root's sum, lane 0 the oldest
+ */
+static uint8_t fold_lanes(const uint8_t lanes[GF_LANES], uint8_t root)
+{
+    uint8_t s = lanes[0];
+
+    for (int k = 1; k < GF_LANES; k++)
+    {
+        s = gf_mul(root, s) ^ lanes[k];
+    }
+
+    return s;
+}
+
+/*
+ * The first chunk holds the len % 16 odd bytes, with zeros
+ * in front, which add nothing. Returns where the whole
+ * chunks start.
+ */
+static int first_chunk(const uint8_t *data, int len, uint8_t chunk[GF_LANES])
+{
+    int odd = len % GF_LANES;
+
+    if (odd == 0)
+        odd = GF_LANES;
+
+    memset(chunk, 0, GF_LANES);
+    memcpy(&chunk[GF_LANES - odd], data, odd);
+
+    return odd;
+}
+
+/*
+ * Reference syndromes, poly form, one byte times one root
+ * at a time. The vector kernels must match it.
+ */
+void rs_syndromes_scalar(struct rs *rs, const uint8_t *data, int len, uint8_t *s)
+{
+    for (int i = 0; i < rs->nroots; i++)
+    {
+        s[i] = data[0];
+    }
+
+    for (int j = 1; j < len; j++)
+    {
+        for (int i = 0; i < rs->nroots; i++)
+        {
+            if (s[i] == 0U)
+            {
+                s[i] = data[j];
+            }
+            else
+            {
+                s[i] = data[j] ^ rs->alpha_to[modnn(rs, (rs->index_of[s[i]] + (rs->fcr + i) * rs->prim))];
+            }
+        }
+    }
+}
+
+/*
+ * Reference encoder, len is the real number of data bytes.
+ * A shortened code has known zeros in front, and they leave
+ * the registers at zero, so they are skipped.
+ */
+void rs_parity_scalar(struct rs *rs, const uint8_t *data, int len, uint8_t *bb)
+{
+    memset(bb, 0, rs->nroots * sizeof(uint8_t)); // clear out the FEC data area
+
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t feedback = rs->index_of[data[i] ^ bb[0]];
+
+        if (feedback != rs->nn) // feedback term is non-zero
+        {
+            for (int j = 1; j < rs->nroots; j++)
+            {
+                bb[j] ^= rs->alpha_to[modnn(rs, (feedback + rs->genpoly[rs->nroots - j]))];
+            }
+        }
+
+        // Shift
+        memmove(&bb[0], &bb[1], sizeof(uint8_t) * (rs->nroots - 1));
+
+        if (feedback != rs->nn)
+        {
+            bb[rs->nroots - 1] = rs->alpha_to[modnn(rs, (feedback + rs->genpoly[0]))];
+        }
+        else
+        {
+            bb[rs->nroots - 1] = 0U;
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("ssse3"))) static inline __m128i gf_vmul_ssse3(__m128i x, uint8_t c)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    __m128i lo = _mm_and_si128(x, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+
+    return _mm_xor_si128(_mm_shuffle_epi8(_mm_load_si128((const __m128i *)mul_lo[c]), lo),
+                         _mm_shuffle_epi8(_mm_load_si128((const __m128i *)mul_hi[c]), hi));
+}
+
+__attribute__((target("ssse3"))) static void syndromes_ssse3(struct rs *rs, const uint8_t *data, int len, uint8_t *s)
+{
+    uint8_t root[GF_LANES];
+    uint8_t root16[GF_LANES];
+    uint8_t chunk[GF_LANES];
+    uint8_t lanes[GF_LANES] __attribute__((aligned(16)));
+
+    root_powers(rs, root, root16);
+
+    int start = first_chunk(data, len, chunk);
+    __m128i first = _mm_loadu_si128((const __m128i *)chunk);
+
+    for (int i = 0; i < rs->nroots; i++)
+    {
+        __m128i acc = first;
+
+        for (int j = start; j < len; j += GF_LANES)
+        {
+            acc = _mm_xor_si128(gf_vmul_ssse3(acc, root16[i]), _mm_loadu_si128((const __m128i *)&data[j]));
+        }
+
+        _mm_store_si128((__m128i *)lanes, acc);
+
+        s[i] = fold_lanes(lanes, root[i]);
+    }
+}
+
+__attribute__((target("ssse3"))) static void parity_ssse3(struct rs *rs, const uint8_t *data, int len, uint8_t *bb)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    uint8_t gen[GF_LANES];
+    uint8_t out[GF_LANES];
+
+    parity_generator(rs, gen);
+
+    __m128i g = _mm_loadu_si128((const __m128i *)gen);
+    __m128i glo = _mm_and_si128(g, mask);
+    __m128i ghi = _mm_and_si128(_mm_srli_epi16(g, 4), mask);
+    __m128i reg = _mm_setzero_si128();
+
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t feedback = data[i] ^ (uint8_t)_mm_cvtsi128_si32(reg);
+
+        __m128i term = _mm_xor_si128(_mm_shuffle_epi8(_mm_load_si128((const __m128i *)mul_lo[feedback]), glo),
+                                     _mm_shuffle_epi8(_mm_load_si128((const __m128i *)mul_hi[feedback]), ghi));
+
+        reg = _mm_xor_si128(_mm_srli_si128(reg, 1), term);
+    }
+
+    _mm_storeu_si128((__m128i *)out, reg);
+    memcpy(bb, out, rs->nroots);
+}
+
+#elif defined(__ARM_NEON)
+
+static inline uint8x16_t tbl16(uint8x16_t table, uint8x16_t index)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(table, index);
+#else
+    uint8x8x2_t t = {{vget_low_u8(table), vget_high_u8(table)}};
+
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(index)), vtbl2_u8(t, vget_high_u8(index)));
+#endif
+}
+
+static inline uint8x16_t gf_vmul_neon(uint8x16_t x, uint8_t c)
+{
+    uint8x16_t lo = vandq_u8(x, vdupq_n_u8(0x0f));
+    uint8x16_t hi = vshrq_n_u8(x, 4);
+
+    return veorq_u8(tbl16(vld1q_u8(mul_lo[c]), lo), tbl16(vld1q_u8(mul_hi[c]), hi));
+}
+
+static void syndromes_neon(struct rs *rs, const uint8_t *data, int len, uint8_t *s)
+{
+    uint8_t root[GF_LANES];
+    uint8_t root16[GF_LANES];
+    uint8_t chunk[GF_LANES];
+    uint8_t lanes[GF_LANES];
+
+    root_powers(rs, root, root16);
+
+    int start = first_chunk(data, len, chunk);
+    uint8x16_t first = vld1q_u8(chunk);
+
+    for (int i = 0; i < rs->nroots; i++)
+    {
+        uint8x16_t acc = first;
+
+        for (int j = start; j < len; j += GF_LANES)
+        {
+            acc = veorq_u8(gf_vmul_neon(acc, root16[i]), vld1q_u8(&data[j]));
+        }
+
+        vst1q_u8(lanes, acc);
+
+        s[i] = fold_lanes(lanes, root[i]);
+    }
+}
+
+static void parity_neon(struct rs *rs, const uint8_t *data, int len, uint8_t *bb)
+{
+    uint8_t gen[GF_LANES];
+    uint8_t out[GF_LANES];
+
+    parity_generator(rs, gen);
+
+    uint8x16_t g = vld1q_u8(gen);
+    uint8x16_t glo = vandq_u8(g, vdupq_n_u8(0x0f));
+    uint8x16_t ghi = vshrq_n_u8(g, 4);
+    uint8x16_t reg = vdupq_n_u8(0);
+
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t feedback = data[i] ^ vgetq_lane_u8(reg, 0);
+
+        uint8x16_t term = veorq_u8(tbl16(vld1q_u8(mul_lo[feedback]), glo),
+                                   tbl16(vld1q_u8(mul_hi[feedback]), ghi));
+
+        reg = veorq_u8(vextq_u8(reg, vdupq_n_u8(0), 1), term);
+    }
+
+    vst1q_u8(out, reg);
+    memcpy(bb, out, rs->nroots);
+}
+
+#endif
+
+/*
+ * Pick the fastest kernels this CPU can run
+ */
+static void select_kernel()
+{
+    unsigned int cpu = cpu_features();
+
+    syndrome_kernel = rs_syndromes_scalar;
+    parity_kernel = rs_parity_scalar;
+    gf_kernel_name = "scalar";
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu & CPU_SSSE3)
+    {
+        syndrome_kernel = syndromes_ssse3;
+        parity_kernel = parity_ssse3;
+        gf_kernel_name = "ssse3";
+    }
+#elif defined(__ARM_NEON)
+    if (cpu & CPU_NEON)
+    {
+        syndrome_kernel = syndromes_neon;
+        parity_kernel = parity_neon;
+        gf_kernel_name = "neon";
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+/*
+ * Build the nibble tables from the field of rs. All
+ * the IL2P codes share the one field.
+ */
+void il2p_gf_init(struct rs *rs)
+{
+    for (int c = 0; c < 256; c++)
+    {
+        for (int n = 0; n < 16; n++)
+        {
+            int h = n << 4;
+
+            mul_lo[c][n] = (c == 0 || n == 0) ? 0U : rs->alpha_to[modnn(rs, rs->index_of[c] + rs->index_of[n])];
+            mul_hi[c][n] = (c == 0 || n == 0) ? 0U : rs->alpha_to[modnn(rs, rs->index_of[c] + rs->index_of[h])];
+        }
+    }
+
+    select_kernel();
+}
+
+const char *il2p_gf_kernel_name()
+{
+    return gf_kernel_name;
+}
+
+/*
+ * Syndromes of a len byte shortened block, in poly form
+ */
+void rs_syndromes(struct rs *rs, const uint8_t *data, int len, uint8_t *s)
+{
+    if (rs->nroots > GF_LANES)
+        rs_syndromes_scalar(rs, data, len, s);
+    else
+        syndrome_kernel(rs, data, len, s);
+}
+
+/*
+ * nroots parity bytes for len data bytes
+ */
+void rs_parity(struct rs *rs, const uint8_t *data, int len, uint8_t *bb)
+{
+    if (rs->nroots > GF_LANES)
+        rs_parity_scalar(rs, data, len, bb);
+    else
+        parity_kernel(rs, data, len, bb);
+}
@@ -530,11 +530,11 @@ int il2p_get_header_attributes(uint8_t *hdr)
     return GET_PAYLOAD_BYTE_COUNT(hdr);
 }
 
-int il2p_clarify_header(uint8_t *rec_hdr, uint8_t *corrected_descrambled_hdr)
+int il2p_clarify_header(uint8_t *rec_hdr, const float *rec_conf, uint8_t *corrected_descrambled_hdr)
 {
     uint8_t corrected[IL2P_HEADER_SIZE + IL2P_HEADER_PARITY];
 
-    int e = il2p_decode_rs(rec_hdr, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY, corrected);
+    int e = il2p_decode_rs(rec_hdr, rec_conf, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY, corrected);
 
     il2p_descramble_block(corrected, corrected_descrambled_hdr, IL2P_HEADER_SIZE);
 
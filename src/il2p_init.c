@@ -23,6 +23,12 @@
 #define NTAB 5
 #define BLOCK_SIZE 255
 
+/*
+ * Bytes whose weakest bit has less confidence than this
+ * are erasure candidates. A clean symbol measures 1.0.
+ */
+#define ERASE_BELOW 0.5f
+
 #define min(a, b) ((a) < (b) ? (a) : (b))
 
 static struct
@@ -53,6 +59,10 @@ void il2p_init()
             exit(EXIT_FAILURE);
         }
     }
+
+    il2p_gf_init(Tab[0].rs);
+    il2p_scramble_init();
+    il2p_rec_init();
 }
 
 // Find RS codec control block for specified number of parity symbols.
@@ -72,47 +82,31 @@ struct rs *il2p_find_rs(int nparity)
     return Tab[0].rs;
 }
 
-void encode_rs_char(struct rs *rs, uint8_t *data, uint8_t *bb)
+/*
+ * len is the real number of data bytes, see il2p_gf.c
+ */
+void encode_rs_char(struct rs *rs, uint8_t *data, int len, uint8_t *bb)
 {
-    memset(bb, 0, rs->nroots * sizeof(uint8_t)); // clear out the FEC data area
-
-    for (int i = 0; i < (rs->nn - rs->nroots); i++)
-    {
-        uint8_t feedback = rs->index_of[data[i] ^ bb[0]];
-
-        if (feedback != rs->nn) // feedback term is non-zero
-        {
-            for (int j = 1; j < rs->nroots; j++)
-            {
-                bb[j] ^= rs->alpha_to[modnn(rs, (feedback + rs->genpoly[rs->nroots - j]))];
-            }
-        }
-
-        // Shift
-        memmove(&bb[0], &bb[1], sizeof(uint8_t) * (rs->nroots - 1));
-
-        if (feedback != rs->nn)
-        {
-            bb[rs->nroots - 1] = rs->alpha_to[modnn(rs, (feedback + rs->genpoly[0]))];
-        }
-        else
-        {
-            bb[rs->nroots - 1] = 0U;
-        }
-    }
+    rs_parity(rs, data, len, bb);
 }
 
 void il2p_encode_rs(uint8_t *tx_data, int data_size, int num_parity, uint8_t *parity_out)
 {
-    uint8_t rs_block[BLOCK_SIZE] = { 0 };
-
-    memcpy(rs_block + sizeof(rs_block) - data_size - num_parity, tx_data, data_size);
-
-    encode_rs_char(il2p_find_rs(num_parity), rs_block, parity_out);
+    encode_rs_char(il2p_find_rs(num_parity), tx_data, data_size, parity_out);
 }
 
-int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos, int no_eras)
+/*
+ * Decode a shortened block of len bytes, data and parity
+ *
+ * The nn - len positions in front are known zeros. They
+ * add nothing to the syndromes, and the Chien search
+ * doesn't look for errors in them. Erasure and error
+ * positions are indexes into data[].
+ */
+int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int len, int *eras_pos, int no_eras)
 {
+    int pad = rs->nn - len;
+
     uint8_t lambda[FEC_MAX_CHECK + 1];
     uint8_t s[FEC_MAX_CHECK]; // Err+Eras Locator poly and syndrome poly
     uint8_t t[FEC_MAX_CHECK + 1];
@@ -124,25 +118,7 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
     int count;
 
     /* form the syndromes; i.e., evaluate data(x) at roots of g(x) */
-    for (int i = 0; i < rs->nroots; i++)
-    {
-        s[i] = data[0];
-    }
-
-    for (int j = 1; j < rs->nn; j++)
-    {
-        for (int i = 0; i < rs->nroots; i++)
-        {
-            if (s[i] == 0U)
-            {
-                s[i] = data[j];
-            }
-            else
-            {
-                s[i] = data[j] ^ rs->alpha_to[modnn(rs, (rs->index_of[s[i]] + (rs->fcr + i) * rs->prim))];
-            }
-        }
-    }
+    rs_syndromes(rs, data, len, s);
 
     /* Convert syndromes to index form, checking for nonzero condition */
     unsigned int syn_error = 0;
@@ -170,11 +146,11 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
     if (no_eras > 0)
     {
         /* Init lambda to be the erasure locator polynomial */
-        lambda[1] = rs->alpha_to[modnn(rs, (rs->prim * (rs->nn - 1U - eras_pos[0])))];
+        lambda[1] = rs->alpha_to[modnn(rs, (rs->prim * (rs->nn - 1U - (eras_pos[0] + pad))))];
 
         for (int i = 1; i < no_eras; i++)
         {
-            uint8_t u = modnn(rs, (rs->prim * (rs->nn - 1U - eras_pos[i])));
+            uint8_t u = modnn(rs, (rs->prim * (rs->nn - 1U - (eras_pos[i] + pad))));
 
             for (int j = i + 1; j > 0; j--)
             {
@@ -268,11 +244,23 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
         }
     }
 
-    /* Find roots of the error+erasure locator polynomial by Chien search */
-    memcpy(&reg[1], &lambda[1], rs->nroots * sizeof(reg[0]));
+    /*
+     * Find roots of the error+erasure locator polynomial by Chien search
+     *
+     * With prim 1, as IL2P uses, step i finds location i - 1, so
+     * the search starts at the first live byte. The registers are
+     * wound on to where it starts.
+     */
+    unsigned int first = (rs->prim == 1U) ? (unsigned int)pad + 1U : 1U;
+
+    for (int j = 1; j <= rs->nroots; j++)
+    {
+        reg[j] = (lambda[j] == rs->nn) ? rs->nn : modnn(rs, lambda[j] + j * (first - 1U));
+    }
+
     count = 0; /* Number of roots of lambda(x) */
 
-    for (uint8_t i = 1, k = (rs->iprim - 1); i <= rs->nn; i++, k = modnn(rs, (k + rs->iprim)))
+    for (unsigned int i = first, k = modnn(rs, rs->iprim - 1U + (first - 1U) * rs->iprim); i <= rs->nn; i++, k = modnn(rs, (k + rs->iprim)))
     {
         uint8_t q = 1U; /* lambda[0] is always 0 */
 
@@ -310,6 +298,20 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
         goto finish;
     }
 
+    /*
+     * Unless prim is 1 the search covers the padding too,
+     * and a root there means too many errors. Nothing can
+     * be corrected in front of data[].
+     */
+    for (int j = 0; j < count; j++)
+    {
+        if (loc[j] < pad)
+        {
+            count = -1;
+            goto finish;
+        }
+    }
+
     /*
      * Compute err+eras evaluator poly omega(x) = s(x)*lambda(x) (modulo
      * x**rs->nroots). in index form. Also find deg(omega).
@@ -342,7 +344,7 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
     {
         uint8_t num1 = 0U;
 
-        for (unsigned int i = deg_omega; i >= 0; i--)
+        for (int i = deg_omega; i >= 0; i--)
         {
             if (omega[i] != rs->nn)
             {
@@ -369,7 +371,7 @@ int decode_rs_char(struct rs *restrict rs, uint8_t *restrict data, int *eras_pos
         /* Apply error to data */
         if (num1 != 0U)
         {
-            data[loc[j]] ^= rs->alpha_to[modnn(rs, (rs->index_of[num1] + rs->index_of[num2] + rs->nn - rs->index_of[den]))];
+            data[loc[j] - pad] ^= rs->alpha_to[modnn(rs, (rs->index_of[num1] + rs->index_of[num2] + rs->nn - rs->index_of[den]))];
         }
     }
 
@@ -377,44 +379,114 @@ finish:
     if (eras_pos != NULL)
     {
         for (int i = 0; i < count; i++)
-            eras_pos[i] = loc[i];
+            eras_pos[i] = loc[i] - pad;
     }
 
     return count;
 }
 
-int il2p_decode_rs(uint8_t *rec_block, int data_size, int num_parity, uint8_t *out)
+/*
+ * Decode a copy of one block, the received block is kept
+ * for another try. The first no_eras entries of derrlocs
+ * are the erased byte positions.
+ */
+static int decode_block(struct rs *rs, uint8_t *rec_block, int n, uint8_t rs_block[], int derrlocs[], int no_eras)
 {
-    //  Use zero padding in front if data size is too small.
+    memcpy(rs_block, rec_block, n);
 
-    int n = data_size + num_parity; // total size in.
+    return decode_rs_char(rs, rs_block, n, derrlocs, no_eras);
+}
 
-    uint8_t rs_block[BLOCK_SIZE];
+/*
+ * Errors only failed, so try again with the least
+ * confident bytes erased. An erasure costs one parity
+ * symbol where an error costs two.
+ *
+ * The worst bytes are erased a few at a time. Errors
+ * found outside the erasures still cost two each, and
+ * a quarter of the parity is kept back from the total
+ * so a wrong block is still seen as wrong. Without
+ * that, a dozen erasures leave a random block within
+ * reach of some codeword nearly half the time.
+ */
+static int decode_erasures(struct rs *rs, uint8_t *rec_block, const float *rec_conf, int n, uint8_t rs_block[], int derrlocs[])
+{
+    int worst[FEC_MAX_CHECK];
+    int budget = rs->nroots - ((rs->nroots >= 4) ? rs->nroots / 4 : 1);
+    int step = (rs->nroots >= 8) ? 2 : 1;
+    int candidates = 0;
 
-    memset(rs_block, 0, sizeof(rs_block) - n);
-    memcpy(rs_block + sizeof(rs_block) - n, rec_block, n);
+    /*
+     * Weakest bytes first, insertion sorted as
+     * there are never more than a dozen kept
+     */
+    for (int i = 0; i < n; i++)
+    {
+        if (rec_conf[i] >= ERASE_BELOW)
+            continue;
 
-    int derrlocs[FEC_MAX_CHECK]; // Half would probably be OK.
+        int j = (candidates < budget) ? candidates++ : budget;
 
-    int derrors = decode_rs_char(il2p_find_rs(num_parity), rs_block, derrlocs, 0);
-    memcpy(out, rs_block + sizeof(rs_block) - n, data_size);
+        while (j > 0 && rec_conf[worst[j - 1]] > rec_conf[i])
+        {
+            if (j < budget)
+                worst[j] = worst[j - 1];
+
+            j--;
+        }
+
+        if (j < budget)
+            worst[j] = i;
+    }
 
-    // It is possible to have a situation where too many errors are
-    // present but the algorithm could get a good code block by "fixing"
-    // one of the padding bytes that should be 0.
+    int derrors = -1;
 
-    for (int i = 0; i < derrors; i++)
+    for (int k = step; derrors < 0 && k - step < candidates && k <= budget; k += step)
     {
-        if (derrlocs[i] < sizeof(rs_block) - n)
+        int no_eras = min(k, candidates);
+
+        for (int i = 0; i < no_eras; i++)
         {
-            derrors = -1;
-            break;
+            derrlocs[i] = worst[i];
         }
+
+        derrors = decode_block(rs, rec_block, n, rs_block, derrlocs, no_eras);
+
+        if (derrors > 0 && (2 * (derrors - no_eras) + no_eras) > budget)
+            derrors = -1;
     }
 
     return derrors;
 }
 
+/*
+ * rec_conf holds the confidence of each received
+ * byte, or is NULL when there is none
+ */
+int il2p_decode_rs(uint8_t *rec_block, const float *rec_conf, int data_size, int num_parity, uint8_t *out)
+{
+    int n = data_size + num_parity; // total size in, a shortened code
+
+    struct rs *rs = il2p_find_rs(num_parity);
+    uint8_t rs_block[BLOCK_SIZE];
+
+    int derrlocs[FEC_MAX_CHECK]; // Half would probably be OK.
+
+    int derrors = decode_block(rs, rec_block, n, rs_block, derrlocs, 0);
+
+    if (derrors < 0 && rec_conf != NULL)
+    {
+        derrors = decode_erasures(rs, rec_block, rec_conf, n, rs_block, derrlocs);
+    }
+
+    memcpy(out, rs_block, data_size);
+
+    // Too many errors can look like a good code block with one of the
+    // padding bytes "fixed". decode_rs_char() returns -1 for that.
+
+    return derrors;
+}
+
 struct rs *init_rs_char(unsigned int gfpoly, unsigned int fcr, unsigned int prim, unsigned int nroots)
 {
     if (fcr >= 256)
@@ -117,7 +117,7 @@ int il2p_encode_payload(uint8_t *payload, int payload_size, uint8_t *enc)
     return encoded_length;
 }
 
-int il2p_decode_payload(uint8_t *received, int payload_size, uint8_t *payload_out, int *symbols_corrected)
+int il2p_decode_payload(uint8_t *received, const float *conf, int payload_size, uint8_t *payload_out, int *symbols_corrected)
 {
     // Determine number of blocks and sizes.
 
@@ -144,7 +144,7 @@ int il2p_decode_payload(uint8_t *received, int payload_size, uint8_t *payload_ou
     {
         memset(corrected_block, 0, 255);
 
-        int e = il2p_decode_rs(pin, ipp.large_block_size, ipp.parity_symbols_per_block, corrected_block);
+        int e = il2p_decode_rs(pin, conf, ipp.large_block_size, ipp.parity_symbols_per_block, corrected_block);
 
         if (e < 0)
             failed = true;
@@ -156,6 +156,9 @@ int il2p_decode_payload(uint8_t *received, int payload_size, uint8_t *payload_ou
         pin += ipp.large_block_size + ipp.parity_symbols_per_block;
         pout += ipp.large_block_size;
 
+        if (conf != NULL)
+            conf += ipp.large_block_size + ipp.parity_symbols_per_block;
+
         decoded_length += ipp.large_block_size;
     }
 
@@ -165,7 +168,7 @@ int il2p_decode_payload(uint8_t *received, int payload_size, uint8_t *payload_ou
     {
         memset(corrected_block, 0, 255);
 
-        int e = il2p_decode_rs(pin, ipp.small_block_size, ipp.parity_symbols_per_block, corrected_block);
+        int e = il2p_decode_rs(pin, conf, ipp.small_block_size, ipp.parity_symbols_per_block, corrected_block);
 
         if (e < 0)
             failed = true;
@@ -176,6 +179,9 @@ int il2p_decode_payload(uint8_t *received, int payload_size, uint8_t *payload_ou
 
         pin += ipp.small_block_size + ipp.parity_symbols_per_block;
         pout += ipp.small_block_size;
+
+        if (conf != NULL)
+            conf += ipp.small_block_size + ipp.parity_symbols_per_block;
     
         decoded_length += ipp.small_block_size;
     }
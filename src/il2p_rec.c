@@ -11,117 +11,278 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+/*
+ * IL2P receive framer
+ *
+ * Looks for the sync word a dibit at a time, then gathers
+ * the header and payload a byte at a time into one frame
+ * buffer. The state is kept from call to call, so the
+ * demodulator can feed it one symbol at a time, and a file
+ * or test vector can feed it whole buffers of bytes.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "ipnode.h"
 #include "il2p.h"
 #include "receive_queue.h"
+#include "constellation.h"
+
+#define IL2P_HEADER_BYTES (IL2P_HEADER_SIZE + IL2P_HEADER_PARITY)
 
 static struct il2p_context_s il2p_context;
+static struct il2p_rec_stats_s il2p_stats;
 
 /*
- * Called from demod
+ * The Costas loop can lock a quarter turn either way, or
+ * a half turn out, and every dibit then comes out mapped.
+ * The sync word is looked for as it would arrive at each
+ * of the four, and the one found says how to map back.
  */
-void il2p_rec_bit(int dbit)
+static unsigned int sync_words[4];  // sync word after 0 to 3 quarter turns
+static uint8_t unturn[4][4];        // [turns][received dibit] is the sent dibit
+static uint8_t unturn_byte[4][256]; // the same for four dibits at once
+
+static uint8_t turn_dibit(uint8_t dibit, int turns)
 {
-    struct il2p_context_s *F = &il2p_context;
-    packet_t pp;
+    for (int i = 0; i < turns; i++)
+    {
+        dibit = qpskRotateDiBit(dibit);
+    }
 
-    memset(F, 0, sizeof(struct il2p_context_s));
+    return dibit;
+}
 
-    // Accumulate most recent 24 bits received.  Most recent is LSB.
+void il2p_rec_init()
+{
+    for (int q = 0; q < 4; q++)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            unturn[q][turn_dibit(d, q)] = d;
+        }
 
-    F->acc = ((F->acc << 1) | (dbit & 1)) & 0x00ffffff;
+        for (int b = 0; b < 256; b++)
+        {
+            unturn_byte[q][b] = (unturn[q][(b >> 6) & 0x3] << 6) | (unturn[q][(b >> 4) & 0x3] << 4) |
+                                (unturn[q][(b >> 2) & 0x3] << 2) | unturn[q][b & 0x3];
+        }
 
-    // State machine to look for sync word then gather appropriate number of header and payload bytes.
+        sync_words[q] = 0;
 
-    switch (F->state)
-    {
-    case IL2P_SEARCHING: // Searching for the sync word.
+        for (int shift = 22; shift >= 0; shift -= 2)
+        {
+            sync_words[q] = (sync_words[q] << 2) | turn_dibit((IL2P_SYNC_WORD >> shift) & 0x3, q);
+        }
+    }
+
+    il2p_rec_reset();
+}
+
+/*
+ * Drop any frame in progress and look for a sync word
+ */
+void il2p_rec_reset()
+{
+    struct il2p_context_s *F = &il2p_context;
+
+    F->state = IL2P_SEARCHING;
+    F->acc = 0;
+}
 
-        if (__builtin_popcount(F->acc ^ IL2P_SYNC_WORD) <= 1) // allow single bit mismatch
+/*
+ * True until a sync word is found, and again once the
+ * frame is decoded or dropped. While a frame is coming
+ * in, the phase turns it was found at are fixed.
+ */
+bool il2p_rec_searching()
+{
+    return il2p_context.state == IL2P_SEARCHING;
+}
+
+void il2p_rec_get_stats(struct il2p_rec_stats_s *stats)
+{
+    *stats = il2p_stats;
+}
+
+/*
+ * The frame buffer has all it asked for
+ *
+ * After the header that is the payload size, and
+ * after the payload the frame is decoded.
+ */
+static void frame_step(struct il2p_context_s *F)
+{
+    if (F->state == IL2P_HEADER)
+    {
+        // Fix any errors and descramble.
+        if (il2p_clarify_header(F->frame, F->conf, F->uhdr) < 0) // Header failed FEC check.
         {
-            F->state = IL2P_HEADER;
-            F->bc = 0;
-            F->hc = 0;
+            il2p_stats.header_fails++;
+            il2p_rec_reset();
+            return;
         }
-        break;
 
-    case IL2P_HEADER: // Gathering the header.
+        // How much payload is expected?
+        il2p_payload_properties_t plprop;
 
-        F->bc++;
+        int eplen = il2p_payload_compute(&plprop, il2p_get_header_attributes(F->uhdr));
 
-        if (F->bc == 8) // full byte has been collected.
+        if (eplen < 0) // Error.
         {
-            F->bc = 0;
+            il2p_stats.header_fails++;
+            il2p_rec_reset();
+            return;
+        }
 
-            F->shdr[F->hc++] = F->acc & 0xff;
+        if (eplen > 0) // Need to gather payload.
+        {
+            F->state = IL2P_PAYLOAD;
+            F->need += eplen;
+            return;
+        }
+    }
 
-            if (F->hc == IL2P_HEADER_SIZE + IL2P_HEADER_PARITY) // Have all of header
+    int corrected = 0;
+
+    packet_t pp = il2p_decode_header_payload(F->uhdr, F->frame + IL2P_HEADER_BYTES, F->conf + IL2P_HEADER_BYTES, &corrected);
+
+    if (pp != NULL)
+    {
+        il2p_stats.frames++;
+        rx_queue_rec_frame(pp);
+    }
+    else
+    {
+        il2p_stats.payload_fails++;
+    }
+
+    il2p_rec_reset();
+}
+
+/*
+ * Called from demod, one symbol at a time
+ *
+ * conf1 and conf0 are how sure the demodulator is of
+ * the MSB and LSB, 1.0 for a clean symbol and near 0 at
+ * the decision boundary. The weakest bit of each byte is
+ * kept with it, and the least confident bytes become
+ * Reed-Solomon erasures.
+ */
+void il2p_rec_dibit(int dibit, float conf1, float conf0)
+{
+    struct il2p_context_s *F = &il2p_context;
+
+    if (F->state == IL2P_SEARCHING)
+    {
+        // Most recent 12 dibits as received.  Most recent is LSB.
+
+        F->acc = ((F->acc << 2) | (dibit & 0x3)) & 0x00ffffff;
+
+        for (int q = 0; q < 4; q++)
+        {
+            if (__builtin_popcount(F->acc ^ sync_words[q]) <= 1) // allow single bit mismatch
             {
-                // Fix any errors and descramble.
-                if (il2p_clarify_header(F->shdr, F->uhdr) >= 0) // Good header.
-                {
-                    // How much payload is expected?
-                    il2p_payload_properties_t plprop;
-
-                    int len = il2p_get_header_attributes(F->uhdr);
-
-                    F->eplen = il2p_payload_compute(&plprop, len);
-
-                    if (F->eplen >= 1) // Need to gather payload.
-                    {
-                        F->pc = 0;
-                        F->state = IL2P_PAYLOAD;
-                    }
-                    else if (F->eplen == 0) // No payload.
-                    {
-                        F->pc = 0;
-                        F->state = IL2P_DECODE;
-                    }
-                    else // Error.
-                    {
-                        F->state = IL2P_SEARCHING;
-                    }
-                }
-                else // corrected == -1
-                {
-                    F->state = IL2P_SEARCHING; // Header failed FEC check.
-                }
+                il2p_stats.syncs++;
+
+                F->state = IL2P_HEADER;
+                F->turns = q;
+                F->dc = 0;
+                F->cur = 0;
+                F->bconf = HUGE_VALF;
+                F->len = 0;
+                F->need = IL2P_HEADER_BYTES;
+                break;
             }
         }
-        break;
 
-    case IL2P_PAYLOAD: // Gathering the payload, if any.
+        return;
+    }
 
-        F->bc++;
+    /*
+     * Map back to the sent dibit. An odd number of quarter
+     * turns swaps the I and Q bits too, which the weakest
+     * bit of the byte doesn't care about.
+     */
+    F->cur = (F->cur << 2) | unturn[F->turns][dibit & 0x3];
+    F->bconf = fminf(F->bconf, fminf(conf1, conf0));
 
-        if (F->bc == 8) // full byte has been collected.
-        {
-            F->bc = 0;
+    if (++F->dc == 4)
+    {
+        F->frame[F->len] = F->cur & 0xff;
+        F->conf[F->len] = F->bconf;
 
-            F->spayload[F->pc++] = F->acc & 0xff;
+        F->dc = 0;
+        F->cur = 0;
+        F->bconf = HUGE_VALF;
 
-            if (F->pc == F->eplen)
+        if (++F->len == F->need)
+            frame_step(F);
+    }
+}
+
+/*
+ * Received dibits packed four to a byte, MSB first, as
+ * qpskToDiBit() gives them. For recordings and tests.
+ *
+ * conf holds the confidence of each byte, or is NULL.
+ * Once a frame is found on a byte boundary the rest of
+ * it is copied across whole.
+ */
+void il2p_rec_bytes(const uint8_t in[], const float conf[], int count)
+{
+    struct il2p_context_s *F = &il2p_context;
+    int i = 0;
+
+    while (i < count)
+    {
+        if (F->state == IL2P_SEARCHING || F->dc != 0)
+        {
+            float c = (conf != NULL) ? conf[i] : 1.0f;
+
+            for (int shift = 6; shift >= 0; shift -= 2)
             {
-                F->state = IL2P_DECODE;
+                il2p_rec_dibit((in[i] >> shift) & 0x3, c, c);
             }
+
+            i++;
+            continue;
         }
-        break;
 
-    case IL2P_DECODE:
-        int corrected = 0;
+        int n = F->need - F->len;
 
-        pp = il2p_decode_header_payload(F->uhdr, F->spayload, &corrected);
+        if (n > count - i)
+            n = count - i;
 
-        if (pp != NULL)
+        if (F->turns == 0)
+        {
+            memcpy(&F->frame[F->len], &in[i], n);
+        }
+        else
         {
-            rx_queue_rec_frame(pp);
+            const uint8_t *map = unturn_byte[F->turns];
+
+            for (int k = 0; k < n; k++)
+                F->frame[F->len + k] = map[in[i + k]];
         }
 
-        F->state = IL2P_SEARCHING;
-        break;
+        if (conf != NULL)
+        {
+            memcpy(&F->conf[F->len], &conf[i], n * sizeof(float));
+        }
+        else
+        {
+            for (int k = 0; k < n; k++)
+                F->conf[F->len + k] = 1.0f;
+        }
+
+        F->len += n;
+        i += n;
+
+        if (F->len == F->need)
+            frame_step(F);
     }
 }
@@ -49,7 +49,103 @@ static inline int descramble_bit(int in, int *state)
     return out;
 }
 
+/*
+ * Both registers are linear, so eight bits from a state
+ * and an input byte is the XOR of eight bits from that
+ * state with zero input and from state zero with that
+ * input. Each table entry has the next state in bits 0-8
+ * and the output byte in bits 16-23.
+ */
+#define TAB_STATE 0x1ff
+#define TAB_OUT_SHIFT 16
+
+static uint32_t tx_state_tab[512];
+static uint32_t tx_input_tab[256];
+static uint32_t rx_state_tab[512];
+static uint32_t rx_input_tab[256];
+
+static uint32_t tx_byte(int state, int in)
+{
+    int out = 0;
+
+    for (int m = 0x80; m != 0; m >>= 1)
+    {
+        out = (out << 1) | scramble_bit((in & m) != 0, &state);
+    }
+
+    return (uint32_t)state | ((uint32_t)out << TAB_OUT_SHIFT);
+}
+
+static uint32_t rx_byte(int state, int in)
+{
+    int out = 0;
+
+    for (int m = 0x80; m != 0; m >>= 1)
+    {
+        out = (out << 1) | descramble_bit((in & m) != 0, &state);
+    }
+
+    return (uint32_t)state | ((uint32_t)out << TAB_OUT_SHIFT);
+}
+
+void il2p_scramble_init()
+{
+    for (int s = 0; s < 512; s++)
+    {
+        tx_state_tab[s] = tx_byte(s, 0);
+        rx_state_tab[s] = rx_byte(s, 0);
+    }
+
+    for (int b = 0; b < 256; b++)
+    {
+        tx_input_tab[b] = tx_byte(0, b);
+        rx_input_tab[b] = rx_byte(0, b);
+    }
+}
+
+/*
+ * A byte at a time from the tables
+ *
+ * The first 5 bits out are dropped, so each output byte
+ * is the last 3 bits of one scrambler byte and the first
+ * 5 of the next. A zero byte past the end gives the 5
+ * flush bits. The next input is read before the output
+ * is written, so in and out may be the same buffer.
+ */
 void il2p_scramble_block(uint8_t *in, uint8_t *out, int len)
+{
+    if (len <= 0)
+        return;
+
+    uint32_t e = tx_state_tab[INIT_TX_LSFR] ^ tx_input_tab[in[0]];
+
+    for (int b = 0; b < len; b++)
+    {
+        uint32_t next = tx_state_tab[e & TAB_STATE] ^ tx_input_tab[(b + 1 < len) ? in[b + 1] : 0];
+
+        out[b] = (uint8_t)(((e >> TAB_OUT_SHIFT) << 5) | ((next >> TAB_OUT_SHIFT) >> 3));
+        e = next;
+    }
+}
+
+void il2p_descramble_block(uint8_t *in, uint8_t *out, int len)
+{
+    uint32_t state = INIT_RX_LSFR;
+
+    for (int b = 0; b < len; b++)
+    {
+        uint32_t e = rx_state_tab[state] ^ rx_input_tab[in[b]];
+
+        out[b] = (uint8_t)(e >> TAB_OUT_SHIFT);
+        state = e & TAB_STATE;
+    }
+}
+
+/*
+ * The bit serial originals, kept as the reference
+ * the tables are checked against
+ */
+void il2p_scramble_block_bits(uint8_t *in, uint8_t *out, int len)
 {
     int tx_lfsr_state = INIT_TX_LSFR;
 
@@ -107,7 +203,7 @@ void il2p_scramble_block(uint8_t *in, uint8_t *out, int len)
     }
 }
 
-void il2p_descramble_block(uint8_t *in, uint8_t *out, int len)
+void il2p_descramble_block_bits(uint8_t *in, uint8_t *out, int len)
 {
     int rx_lfsr_state = INIT_RX_LSFR;
 
@@ -26,7 +26,7 @@
 #include "constellation.h"
 
 /*
- * Transmit bits are stored in tx_bits array
+ * Encoded bytes are streamed to the modulator
  */
 int il2p_send_frame(packet_t pp)
 {
@@ -46,34 +46,9 @@ int il2p_send_frame(packet_t pp)
 
     elen += IL2P_SYNC_WORD_SIZE;
 
-    uint8_t tx_bits[elen * 8];
+    tx_frame_bytes(Mode_QPSK, encoded, elen);
 
-    for (int i = 0; i < (elen * 8); i++)
-    {
-        tx_bits[i] = 0U;
-    }
-
-    int number_of_bits = 0;
-
-    /*
-     * Send byte to modulator MSB first
-     */
-    for (int j = 0; j < elen; j++)
-    {
-        uint8_t x = encoded[j];
-
-        for (int k = 0; k < 8; k++)
-        {
-            tx_bits[(j * 8) + k] = (x & 0x80) != 0;
-            x <<= 1;
-        }
-
-        number_of_bits += 8;
-    }
-
-    tx_frame_bits(Mode_QPSK, tx_bits, number_of_bits);
-
-    return number_of_bits;
+    return elen * 8; // number of bits
 }
 
 /*
@@ -83,26 +58,16 @@ int il2p_send_frame(packet_t pp)
  */
 void il2p_send_idle(int num_flags)
 {
-    int number_of_bits = 0;
+    uint8_t flags[32];
 
-    uint8_t tx_bits[num_flags * 8];  // one flag is 8-Bits
+    memset(flags, FLAG, sizeof(flags));
 
-    /*
-     * Send byte to modulator MSB first
-     */
-    for (int i = 0; i < num_flags; i++)
+    while (num_flags > 0)
     {
-        uint8_t x = FLAG;
+        int n = (num_flags < (int)sizeof(flags)) ? num_flags : (int)sizeof(flags);
 
-        for (int j = 0; j < 8; j++)
-        {
-            tx_bits[(i * 8) + j] = (x & 0x80) != 0;
-            x <<= 1;
-        }
+        tx_frame_bytes(Mode_SYNC, flags, n);
 
-        number_of_bits += 8;
+        num_flags -= n;
     }
-
-    tx_frame_bits(Mode_SYNC, tx_bits, number_of_bits);
 }
-
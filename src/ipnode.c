@@ -42,6 +42,11 @@
 #include "constellation.h"
 #include "rrc_fir.h"
 #include "ted.h"
+#include "symbol_sync.h"
+#include "freq_acq.h"
+#include "rt_sched.h"
+#include "channel_sim.h"
+#include "bench.h"
 
 bool node_shutdown;
 
@@ -64,6 +69,19 @@ static void cleanup(int x)
     exit(0);
 }
 
+static void usage()
+{
+    fprintf(stderr, "Usage: %s [-c config] [-i input] [-o output]\n", progname);
+    fprintf(stderr, "  -c file   Config file, default ipnode.conf\n");
+    fprintf(stderr, "  -i file   Receive audio from a WAV or raw S16_LE file at 9600, - for stdin\n");
+    fprintf(stderr, "  -o file   Transmit audio to a WAV (.wav) or raw file, - for stdout\n");
+    fprintf(stderr, "  -S[spec]  Run the modem through a simulated channel and report PER\n");
+    fprintf(stderr, "            spec is key=value,... with ebn0=start:stop:step n= len= cfo= ppm= mp=gain:delay seed= txdelay=\n");
+    fprintf(stderr, "  -B[name]  Run the DSP benchmarks, or just the one named\n");
+    fprintf(stderr, "With -i the soundcard is not used, and input is processed as fast as possible.\n");
+    exit(1);
+}
+
 static void app_process_rec_packet(packet_t pp)
 {
     uint8_t fbuf[AX25_MAX_PACKET_LEN];
@@ -118,6 +136,9 @@ int main(int argc, char *argv[])
 {
     char config_file[100];
     char input_file[80];
+    char output_file[80];
+    char *sim_spec = NULL;
+    bool simulate = false;
 
     if (getuid() == 0 || geteuid() == 0)
     {
@@ -134,10 +155,63 @@ int main(int argc, char *argv[])
 
     // default name
     strlcpy(config_file, "ipnode.conf", sizeof(config_file));
+    strlcpy(input_file, "", sizeof(input_file));
+    strlcpy(output_file, "", sizeof(output_file));
+
+    int c;
+
+    while ((c = getopt(argc, argv, "c:i:o:S::B::h")) != -1)
+    {
+        switch (c)
+        {
+        case 'c':
+            strlcpy(config_file, optarg, sizeof(config_file));
+            break;
+
+        case 'i':
+            strlcpy(input_file, optarg, sizeof(input_file));
+            break;
+
+        case 'o':
+            strlcpy(output_file, optarg, sizeof(output_file));
+            break;
+
+        case 'S':
+            simulate = true;
+            sim_spec = optarg;
+            break;
+
+        case 'B':
+            exit(bench_run(optarg));
+
+        default:
+            usage();
+        }
+    }
+
+    if (output_file[0] != '\0' && input_file[0] == '\0')
+    {
+        fprintf(stderr, "Output file -o needs an input file -i\n");
+        usage();
+    }
 
     config_init(config_file, &audio_config, &misc_config);
 
-    strlcpy(input_file, "", sizeof(input_file));
+    strlcpy(audio_config.input_file, input_file, sizeof(audio_config.input_file));
+    strlcpy(audio_config.output_file, output_file, sizeof(audio_config.output_file));
+
+    /*
+     * Modem loopback, no soundcard or threads
+     */
+    if (simulate == true)
+    {
+        exit(channel_sim_run(&audio_config, sim_spec));
+    }
+
+    /*
+     * Lock memory before any threads or buffers exist
+     */
+    rt_sched_init(&audio_config);
 
     signal(SIGINT, cleanup);
 
@@ -148,7 +222,7 @@ int main(int argc, char *argv[])
 
     if (err < 0)
     {
-        fprintf(stderr, "Fatal: No audio device found %d\n", err);
+        fprintf(stderr, "Fatal: No %s audio device found %d\n", audio_backend_name(), err);
         SLEEP_SEC(5);
         exit(1);
     }
@@ -161,6 +235,8 @@ int main(int argc, char *argv[])
      */
     rrc_make(FS, RS, .35f);
 
+    fprintf(stderr, "RRC filter using %s kernel\n", rrc_fir_kernel_name());
+
     /*
      * Create a costas loop
      *
@@ -171,19 +247,43 @@ int main(int argc, char *argv[])
      */
     create_control_loop((TAU / 180.0f), -1.0f, 1.0f);
 
+    /*
+     * FFT frequency estimate to seed it at burst start
+     */
+    create_freq_acq();
+
     node_shutdown = false;
 
     rx_queue_init();
     ax25_link_init(&misc_config);
     il2p_init();
+
+    fprintf(stderr, "IL2P Reed-Solomon using %s kernel\n", il2p_gf_kernel_name());
+
     // ptt_init(&audio_config);       ///////////// TODO disabled for debugging
     tx_init(&audio_config);
-    rx_init(&audio_config);
 
+    /*
+     * The receive thread uses the TED right away
+     */
     create_timing_error_detector();
 
+    /*
+     * Symbol timing loop, bandwidth per symbol, damping,
+     * and the most the period can stretch in samples
+     */
+    create_symbol_sync((float)CYCLES, SYMSYNC_LOOP_BW, SYMSYNC_DAMPING, SYMSYNC_MAX_DEV);
+
+    rx_init(&audio_config);
+
     kisspt_init();                    // kiss pseudo-terminal
 
+    /*
+     * Set after the other threads are created,
+     * so they don't inherit the link policy.
+     */
+    rt_sched_thread(THTYPE_LINK);
+
     // Run as a daemon process forever
 
     rx_process();
@@ -38,7 +38,7 @@ extern "C"
 #define CENTER 1000.0
 #define FS 9600.0
 #define RS 1200.0
-#define CYCLES (int)(FS/RS)
+#define CYCLES 8 // FS / RS, must be an integer constant
 
 /*
  * Idle Flag
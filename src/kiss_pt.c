@@ -34,6 +34,7 @@
 #include "kiss_pt.h"
 #include "transmit_queue.h"
 #include "transmit_thread.h"
+#include "rt_sched.h"
 
 #define TMP_KISSTNC_SYMLINK "/tmp/kisstnc"
 
@@ -87,6 +88,8 @@ static int kisspt_get()
 
 static void *kisspt_listen_thread(void *arg)
 {
+    rt_sched_thread(THTYPE_KISS);
+
     while (1)
     {
         uint8_t chr = kisspt_get();  // calls select() so waits for data
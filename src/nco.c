@@ -0,0 +1,166 @@
+/*
+ * nco.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Block oscillator for the passband mixers
+ *
+ * The old mixers ran phase *= rect once a sample, and the
+ * rounding in that recurrence lets the amplitude walk away
+ * from one over hours of uptime.
+ *
+ * Here the phase is an unsigned 32-bit accumulator, wrapping
+ * at one cycle. A block starts from cos/sin of the accumulator
+ * and the rest of it is that phasor times a table of exp(jk*step)
+ * computed once in double. Nothing carries from block to block
+ * but the integer phase, so errors can't build up, and the inner
+ * loops are plain float multiplies that the compiler vectorizes.
+ */
+
+#include <math.h>
+#include <complex.h>
+#include <stdint.h>
+
+#include "ipnode.h"
+#include "nco.h"
+
+#define NCO_CYCLE 4294967296.0 // 2^32 phase steps per cycle
+
+/*
+ * freq and fs in Hz, a negative freq turns
+ * the other way (for down conversion)
+ */
+void nco_init(struct nco_s *nco, double freq, double fs)
+{
+    nco->step = (uint32_t)(int64_t)llround((freq / fs) * NCO_CYCLE);
+
+    for (int k = 0; k < NCO_BLOCK; k++)
+    {
+        /*
+         * Same integer phase the accumulator
+         * will have k samples into a block
+         */
+        uint32_t p = nco->step * (uint32_t)k;
+        double angle = (TAU * (double)p) / NCO_CYCLE;
+
+        nco->rot_re[k / 4][k % 4] = (float)cos(angle);
+        nco->rot_im[k / 4][k % 4] = (float)sin(angle);
+    }
+
+    nco_reset(nco);
+}
+
+void nco_reset(struct nco_s *nco)
+{
+    nco->phase = 0;
+}
+
+/*
+ * Oscillator samples for the next block of n, and step the
+ * accumulator past it. Worked four at a time with the GCC
+ * vector extension, so SSE or NEON without any dispatch.
+ * n is rounded up, re and im hold NCO_BLOCK.
+ */
+static void nco_osc(struct nco_s *nco, int n, v4f re[], v4f im[])
+{
+    float angle = (float)((TAU * (double)nco->phase) / NCO_CYCLE);
+    v4f a_re = {0.0f, 0.0f, 0.0f, 0.0f};
+    v4f a_im = a_re;
+
+    a_re += cosf(angle);
+    a_im += sinf(angle);
+
+    for (int k = 0; k < (n + 3) / 4; k++)
+    {
+        re[k] = a_re * nco->rot_re[k] - a_im * nco->rot_im[k];
+        im[k] = a_re * nco->rot_im[k] + a_im * nco->rot_re[k];
+    }
+
+    nco->phase += nco->step * (uint32_t)n;
+}
+
+/*
+ * count samples of exp(j*phase)
+ */
+void nco_block(struct nco_s *nco, complex float out[], int count)
+{
+    v4f vre[NCO_BLOCK / 4];
+    v4f vim[NCO_BLOCK / 4];
+    const float *re = (const float *)vre;
+    const float *im = (const float *)vim;
+
+    while (count > 0)
+    {
+        int n = (count < NCO_BLOCK) ? count : NCO_BLOCK;
+
+        nco_osc(nco, n, vre, vim);
+
+        for (int k = 0; k < n; k++)
+        {
+            out[k] = CMPLXF(re[k], im[k]);
+        }
+
+        out += n;
+        count -= n;
+    }
+}
+
+/*
+ * Real passband to complex baseband, out = in * exp(j*phase)
+ */
+void nco_mix_down(struct nco_s *nco, const float in[], complex float out[], int count)
+{
+    v4f vre[NCO_BLOCK / 4];
+    v4f vim[NCO_BLOCK / 4];
+    const float *re = (const float *)vre;
+    const float *im = (const float *)vim;
+
+    while (count > 0)
+    {
+        int n = (count < NCO_BLOCK) ? count : NCO_BLOCK;
+
+        nco_osc(nco, n, vre, vim);
+
+        for (int k = 0; k < n; k++)
+        {
+            out[k] = CMPLXF(re[k] * in[k], im[k] * in[k]);
+        }
+
+        in += n;
+        out += n;
+        count -= n;
+    }
+}
+
+/*
+ * Complex baseband to real passband, out = real(in * exp(j*phase))
+ */
+void nco_mix_up(struct nco_s *nco, const complex float in[], float out[], int count)
+{
+    v4f vre[NCO_BLOCK / 4];
+    v4f vim[NCO_BLOCK / 4];
+    const float *re = (const float *)vre;
+    const float *im = (const float *)vim;
+
+    while (count > 0)
+    {
+        int n = (count < NCO_BLOCK) ? count : NCO_BLOCK;
+
+        nco_osc(nco, n, vre, vim);
+
+        for (int k = 0; k < n; k++)
+        {
+            out[k] = crealf(in[k]) * re[k] - cimagf(in[k]) * im[k];
+        }
+
+        in += n;
+        out += n;
+        count -= n;
+    }
+}
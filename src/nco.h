@@ -0,0 +1,49 @@
+/*
+ * nco.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <complex.h>
+
+#define NCO_BLOCK 64 // samples made from one phase anchor, multiple of 4
+
+    typedef float v4f __attribute__((vector_size(16)));
+
+    /*
+     * Numerically controlled oscillator
+     *
+     * The 32-bit phase accumulator is exact, so the phase
+     * never drifts. Each block of up to NCO_BLOCK samples
+     * is the phasor at the accumulator times a fixed table
+     * of rotations, which keeps the amplitude at one.
+     */
+    struct nco_s
+    {
+        uint32_t phase;
+        uint32_t step;
+        v4f rot_re[NCO_BLOCK / 4];
+        v4f rot_im[NCO_BLOCK / 4];
+    };
+
+    void nco_init(struct nco_s *, double, double);
+    void nco_reset(struct nco_s *);
+    void nco_block(struct nco_s *, complex float[], int);
+    void nco_mix_down(struct nco_s *, const float[], complex float[], int);
+    void nco_mix_up(struct nco_s *, const complex float[], float[], int);
+
+#ifdef __cplusplus
+}
+#endif
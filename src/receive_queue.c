@@ -114,7 +114,7 @@ static void append_to_rx_queue(struct rx_queue_item_s *pnew)
 }
 
 /*
- * Called from il2p_rec upon IL2P_DECODE
+ * Called from il2p_rec when a frame decodes
  */
 void rx_queue_rec_frame(packet_t pp)
 {
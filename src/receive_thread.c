@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <complex.h>
+#include <stdatomic.h>
 
 #include "ipnode.h"
 #include "audio.h"
@@ -33,26 +34,41 @@
 #include "ptt.h"
 #include "constellation.h"
 #include "ted.h"
+#include "symbol_sync.h"
+#include "nco.h"
+#include "freq_acq.h"
+#include "dcd.h"
 #include "ax25_link.h"
+#include "sample_ring.h"
+#include "rt_sched.h"
+#include "transmit_thread.h"
 
 extern bool node_shutdown;
 
+#define SOFT_SMOOTH (1.0f / 64.0f) // symbols, for the soft bit scale
+
 static pthread_t rx_tid;
+static pthread_t capture_tid;
+
+/*
+ * Samples from the capture thread to the DSP thread
+ */
+static struct sample_ring_s rx_ring;
+static int rx_block; // samples per read, a multiple of CYCLES
 
 // Globals
 
 static struct demodulator_state_s demod_state;
 static struct demodulator_state_s *D = &demod_state;
 
-static complex float rx_filter[NTAPS];
-static complex float m_rxPhase;
-static complex float m_rxRect;
+static struct nco_s rx_nco;
 static complex float recvBlock[8]; // 8 CYCLES per symbol
 
 static float m_frequency_error;
 static float m_timing_error;
+static float m_soft_level; // mean distance of the symbols from the boundaries
 
-static bool dcdDetect;
+static atomic_bool dcdDetect; // polled by the transmit thread
 
 static float cnormf(complex float val)
 {
@@ -63,44 +79,15 @@ static float cnormf(complex float val)
 }
 
 /*
- * QPSK Receive function
- *
- * Process a vector of real samples at 9600 rate
- * Remove any frequency and timing offsets
- *
- * Vector samples are converted to baseband
- * from the passband center frequency of 1 kHz.
+ * One symbol from the timing loop
  *
- * Results in one 1200 Baud decoded symbol
- * which the dibits are sent on to the L2
- * protocol decoder.
+ * Derotate with the Costas loop, make the
+ * decision, and send the dibits to the decoder.
  */
-static void processSymbols(float csamples[])
+static void processSymbol(complex float decision)
 {
     uint8_t diBits;
 
-    /*
-     * Convert 9600 rate samples to baseband.
-     */
-    for (int i = 0; i < CYCLES; i++)
-    {
-        m_rxPhase *= m_rxRect;
-
-        recvBlock[i] = m_rxPhase * csamples[i];
-    }
-
-    rrc_fir(rx_filter, recvBlock, CYCLES);
-
-    /*
-     * Decimate by 4 for TED calculation (two samples per symbol)
-     */
-    for (int i = 0; i < CYCLES; i += 4)
-    {
-        ted_input(&recvBlock[i]);
-    }
-
-    complex float decision = getMiddleSample(); // use middle TED sample
-
     /*
      * Update audio levels (not really used yet)
      */
@@ -128,7 +115,7 @@ static void processSymbols(float csamples[])
          (1.0f - D->sluggish_decay);
     }
 
-    complex float costasSymbol = decision * cmplxconj(get_phase());
+    complex float costasSymbol = derotate(decision);
 
     float phase_error = phase_detector(costasSymbol);
 
@@ -137,28 +124,97 @@ static void processSymbols(float csamples[])
     frequency_limit();
 
     /*
-     * If the phase error isn't near +/- Pi/4 radians
-     * it probably can't be decoded properly.
-     * 
-     * TODO Pi/4 radians is a WAG
+     * Coarse frequency from the 4th power spectrum, at
+     * the start of a burst this seeds the loop phase and
+     * frequency for the next symbol.
+     *
+     * Only while the decoder is looking for the sync word.
+     * The seeded phase can land a quarter turn out, and
+     * once a frame is found its turns must not change.
      */
-    if (fabsf(phase_error) <= (M_PI / 4.0f))
+    if (il2p_rec_searching() == true)
     {
-        dcdDetect = true;
-        
-        diBits = qpskToDiBit(costasSymbol);
-        
-        /*
-         * Add to the output stream MSB first
-         */
-        il2p_rec_bit((diBits >> 1) & 0x1);
-        il2p_rec_bit(diBits & 0x1);
+        freq_acq_input(decision);
+    }
+    else
+    {
+        freq_acq_reset();
+    }
+
+    /*
+     * Carrier detect from the symbol error vector. The
+     * transmitter waits on it, and it drives the DCD line.
+     */
+    if (dcd_input(costasSymbol) == true)
+    {
+        if (get_dcd() == true)
+        {
+            freq_acq_reset(); // burst start, estimate from its symbols only
+        }
+
+        atomic_store(&dcdDetect, get_dcd());
+        ptt_set(OCTYPE_DCD, get_dcd());
+        tx_wakeup();
     }
 
     /*
-     * Okay, toggle DCD back to off
+     * Every decision goes to the decoder, which finds
+     * its own way in with the sync word. Dropping
+     * symbols would only slip the bit stream.
+     */
+    diBits = qpskToDiBit(costasSymbol);
+
+    /*
+     * Each bit carries its distance from the decision
+     * boundary, scaled so a clean symbol is 1.0 whatever
+     * the audio level. The decoder erases weak bytes.
+     */
+    float soft_re = fabsf(crealf(costasSymbol));
+    float soft_im = fabsf(cimagf(costasSymbol));
+    float level = (soft_re + soft_im) * 0.5f;
+
+    m_soft_level = (m_soft_level == 0.0f) ? level : m_soft_level + SOFT_SMOOTH * (level - m_soft_level);
+
+    float scale = (m_soft_level > 1e-12f) ? 1.0f / m_soft_level : 0.0f;
+
+    /*
+     * The decoder sorts out which way round the
+     * Costas loop locked from the sync word
+     */
+    il2p_rec_dibit(diBits, soft_im * scale, soft_re * scale);
+}
+
+/*
+ * QPSK Receive function
+ *
+ * Process a vector of real samples at 9600 rate
+ * Remove any frequency and timing offsets
+ *
+ * Vector samples are converted to baseband
+ * from the passband center frequency of 1 kHz.
+ *
+ * Usually results in one 1200 Baud symbol, but the
+ * timing loop may give none or two when it slips.
+ * The dibits are sent on to the L2 protocol decoder.
+ */
+static void processSymbols(float csamples[])
+{
+    complex float symbols[SYMSYNC_MAX_OUT];
+
+    /*
+     * Convert 9600 rate samples to baseband.
+     */
+    nco_mix_down(&rx_nco, csamples, recvBlock, CYCLES);
+
+    /*
+     * Matched filter only at the TED instants (two per symbol)
      */
-    dcdDetect = false;
+    int n = symbol_sync(recvBlock, CYCLES, symbols);
+
+    for (int i = 0; i < n; i++)
+    {
+        processSymbol(symbols[i]);
+    }
 
     /*
      * Detected frequency error (for external display maybe)
@@ -168,32 +224,82 @@ static void processSymbols(float csamples[])
 }
 
 /*
- * Called by receive thread
+ * Demodulate count samples, count a multiple of CYCLES
  *
- * This will fill the csamples vector
- * with a CYCLES (8) worth of real values
- * which is at the 9600 sample rate
+ * Called from the DSP thread, or directly by the
+ * channel simulator which has no threads.
  */
-static bool demod_get_samples(float csamples[])
+void rx_process_block(float samples[], int count)
 {
-    for (int i = 0; i < CYCLES; i++)
+    /*
+     * Process each vector of CYCLES (8)
+     */
+    for (int i = 0; i <= (count - CYCLES); i += CYCLES)
     {
-        int lsb = audio_get(); // get real bytes
+        processSymbols(&samples[i]);
+    }
+}
+
+/*
+ * Demodulator back to its startup state
+ */
+void rx_reset()
+{
+    atomic_store(&dcdDetect, false);
+    dcd_reset();
+
+    nco_init(&rx_nco, -CENTER, FS);
 
-        if (lsb < 0)
-            return false;
+    m_frequency_error = 0.0f;
+    m_timing_error = 0.0f;
+    m_soft_level = 0.0f;
+
+    memset(D, 0, sizeof(struct demodulator_state_s));
+
+    D->quick_attack = 0.080f * 0.2f;
+    D->sluggish_decay = 0.00012f * 0.2f;
+
+    symbol_sync_reset();
+    freq_acq_reset();
+    il2p_rec_reset();
+}
+
+/*
+ * Capture thread
+ *
+ * Does nothing but move whole periods from the soundcard
+ * into the ring, so a slow DSP block doesn't overrun ALSA.
+ */
+static void *rx_capture_thread(void *arg)
+{
+    rt_sched_thread(THTYPE_CAPTURE);
 
-        int msb = audio_get();
+    float *samples = (float *)calloc(rx_block, sizeof(float));
 
-        if (msb < 0)
-            return false;
+    if (samples == NULL)
+    {
+        fprintf(stderr, "rx_capture_thread: Out of memory for audio samples\n");
+        exit(1);
+    }
 
-        signed short pcm = ((msb << 8) | lsb) & 0xffff;
+    while (node_shutdown == false)
+    {
+        if (audio_read(samples, rx_block) != rx_block)
+        {
+            break;
+        }
 
-        csamples[i] = (float) pcm / 32768.0f;
+        sample_ring_write(&rx_ring, samples, rx_block);
     }
 
-    return true;
+    /*
+     * Input failed or ran out, let the DSP thread drain
+     */
+    sample_ring_close(&rx_ring);
+
+    free(samples);
+
+    return 0;
 }
 
 /*
@@ -203,68 +309,135 @@ static bool demod_get_samples(float csamples[])
  */
 static void *rx_adev_thread(void *arg)
 {
-    float csamples[CYCLES];
+    unsigned long reported = 0UL;
+    double total = 0.0;
+
+    rt_sched_thread(THTYPE_RX);
+
+    float *samples = (float *)calloc(rx_block, sizeof(float));
+
+    if (samples == NULL)
+    {
+        fprintf(stderr, "rx_adev_thread: Out of memory for audio samples\n");
+        exit(1);
+    }
+
+    double start = dtime_now();
 
     while (node_shutdown == false)
     {
         /*
-         * Get a vector of CYCLES (8)
-         * complex IQ values at 9600 rate
+         * Get a block of real values at 9600 rate
          */
-        if (demod_get_samples(csamples) == true)
+        if (sample_ring_read(&rx_ring, samples, rx_block) == false)
+        {
+            break;
+        }
+
+        total += rx_block;
+
+        rx_process_block(samples, rx_block);
+
+        unsigned long overflows = atomic_load(&rx_ring.overflows);
+
+        if (overflows != reported)
         {
-            /*
-             * If successful, process the vector
-             * This will toggle DCD based on Costas Loop 
-             */
-            processSymbols(csamples);
+            fprintf(stderr, "Receive ring overflow, %lu samples dropped so far. Try a larger RXRING.\n",
+                    (unsigned long)atomic_load(&rx_ring.dropped));
+            reported = overflows;
         }
     }
 
+    free(samples);
+
+    if (audio_is_realtime() == false)
+    {
+        double elapsed = dtime_now() - start;
+
+        fprintf(stderr, "\nEnd of input: %.1f seconds of audio in %.2f seconds, %.1f times real time\n",
+                total / FS, elapsed, (elapsed > 0.0) ? (total / FS) / elapsed : 0.0);
+
+        /*
+         * Give the link layer a moment with the last frames
+         */
+        SLEEP_SEC(1);
+        audio_close();
+        exit(0);
+    }
+
     fprintf(stderr, "\nShutdown: Terminating after audio input closed.\n");
     exit(1);
 }
 
 void rx_init(struct audio_s *pa)
 {
-    if (pa->defined == true)
+    if (pa->defined == false)
     {
-        int e = pthread_create(&rx_tid, NULL, rx_adev_thread, 0);
+        fprintf(stderr, "rx_init: %s(): No audio device defined\n", __func__);
+        exit(1);
+    }
 
-        if (e != 0)
-        {
-            fprintf(stderr, "rx_init: Could not create receive audio thread\n");
-            exit(1);
-        }
+    rx_reset();
+
+    /*
+     * Read a whole capture period at a time,
+     * trimmed to a multiple of CYCLES (8)
+     */
+    rx_block = (audio_period_frames() / CYCLES) * CYCLES;
+
+    if (rx_block < CYCLES)
+    {
+        rx_block = CYCLES;
     }
-    else
+
+    /*
+     * Ring depth is in mS, but always hold a few blocks
+     */
+    unsigned int depth = (unsigned int)((pa->rxring * FS) / 1000.0);
+
+    if (depth < (unsigned int)(4 * rx_block))
+    {
+        depth = 4 * rx_block;
+    }
+
+    /*
+     * A file can always wait for the demodulator, so never drop
+     */
+    if (sample_ring_init(&rx_ring, depth, audio_is_realtime() == false) == false)
     {
-        fprintf(stderr, "rx_init: %s(): No audio device defined\n", __func__);
         exit(1);
     }
 
-    dcdDetect = false;
+    int e = pthread_create(&rx_tid, NULL, rx_adev_thread, 0);
 
-    m_rxRect = cmplxconj((TAU * CENTER) / FS);
-    m_rxPhase = cmplx(0.0f);
+    if (e != 0)
+    {
+        fprintf(stderr, "rx_init: Could not create receive audio thread\n");
+        exit(1);
+    }
 
-    m_frequency_error = 0.0f;
-    m_timing_error = 0.0f;
+    e = pthread_create(&capture_tid, NULL, rx_capture_thread, 0);
 
-    memset(D, 0, sizeof(struct demodulator_state_s));
+    if (e != 0)
+    {
+        fprintf(stderr, "rx_init: Could not create audio capture thread\n");
+        exit(1);
+    }
+}
 
-    D->quick_attack = 0.080f * 0.2f;
-    D->sluggish_decay = 0.00012f * 0.2f;
+unsigned long get_rx_overflows()
+{
+    return atomic_load(&rx_ring.overflows);
 }
 
 bool get_dcd_detect()
 {
-    return dcdDetect;
+    return atomic_load(&dcdDetect);
 }
 
 void set_dcd_detect(bool val)
 {
-    dcdDetect = val;
+    atomic_store(&dcdDetect, val);
 }
 
 /*
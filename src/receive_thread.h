@@ -40,6 +40,9 @@ extern "C"
     void set_dcd_detect(bool);
     float get_frequency_error(void);
     float get_timing_error(void);
+    unsigned long get_rx_overflows(void);
+    void rx_reset(void);
+    void rx_process_block(float *, int);
 
 #ifdef __cplusplus
 }
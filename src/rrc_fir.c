@@ -13,15 +13,219 @@
 #include <math.h>
 #include <string.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "ipnode.h"
 #include "rrc_fir.h"
+#include "cpu_features.h"
+
+typedef complex float (*fir_kernel_t)(const complex float *, const float *, int);
 
 static float coeffs[NTAPS];
 
+/*
+ * Taps reversed (newest sample first), each one duplicated
+ * to line up with the interleaved re/im of the history, and
+ * zero padded to NTAPS_PADDED. The real x complex product
+ * then becomes a plain float multiply-accumulate.
+ */
+static float rtaps[2 * NTAPS_PADDED] __attribute__((aligned(32)));
+
+/*
+ * The same taps split into CYCLES branches for the interpolator.
+ *
+ * Zero-stuffing a symbol stream and running the full filter
+ * means output sample (m * CYCLES + p) only ever sees the taps
+ * p, p + CYCLES, p + 2 * CYCLES... so each branch keeps just those.
+ */
+static float ptaps[CYCLES][2 * PHASE_TAPS] __attribute__((aligned(32)));
+
+/*
+ * The receive filter at FRAC_PHASES + 1 fractional delays,
+ * in the rtaps layout. Bank p gives the filter output p /
+ * FRAC_PHASES of a sample after the newest input, so the
+ * timing loop gets its interpolant straight from the input
+ * and only the outputs it uses are ever computed.
+ */
+static float ftaps[FRAC_PHASES + 1][2 * NTAPS_PADDED] __attribute__((aligned(32)));
+
+static fir_kernel_t fir_kernel;
+static const char *fir_kernel_name;
+
+/*
+ * Reference dot product. The vector kernels must match it.
+ *
+ * taps has 2 * count floats, count is a multiple of 4
+ */
+static complex float fir_scalar(const complex float *window, const float *taps, int count)
+{
+    complex float y = 0.0f;
+
+    for (int i = 0; i < count; i++)
+    {
+        y += (window[i] * taps[2 * i]);
+    }
+
+    return y;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+static complex float fir_sse2(const complex float *window, const float *taps, int count)
+{
+    const float *x = (const float *)window;
+
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (int i = 0; i < (2 * count); i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&x[i]), _mm_load_ps(&taps[i])));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&x[i + 4]), _mm_load_ps(&taps[i + 4])));
+    }
+
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0)); // re, im in lanes 0, 1
+
+    float out[4];
+
+    _mm_storeu_ps(out, acc0);
+
+    return CMPLXF(out[0], out[1]);
+}
+
+__attribute__((target("avx2,fma")))
+static complex float fir_avx2(const complex float *window, const float *taps, int count)
+{
+    const float *x = (const float *)window;
+
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    int i = 0;
+
+    for (; i <= (2 * count) - 16; i += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[i]), _mm256_load_ps(&taps[i]), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[i + 8]), _mm256_load_ps(&taps[i + 8]), acc1);
+    }
+
+    if (i < (2 * count))
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[i]), _mm256_load_ps(&taps[i]), acc0);
+    }
+
+    acc0 = _mm256_add_ps(acc0, acc1);
+
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+
+    float out[4];
+
+    _mm_storeu_ps(out, sum);
+
+    return CMPLXF(out[0], out[1]);
+}
+
+#elif defined(__ARM_NEON)
+
+static complex float fir_neon(const complex float *window, const float *taps, int count)
+{
+    const float *x = (const float *)window;
+
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+    for (int i = 0; i < (2 * count); i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(&x[i]), vld1q_f32(&taps[i]));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(&x[i + 4]), vld1q_f32(&taps[i + 4]));
+    }
+
+    acc0 = vaddq_f32(acc0, acc1);
+
+    float32x2_t sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0)); // re, im
+
+    return CMPLXF(vget_lane_f32(sum, 0), vget_lane_f32(sum, 1));
+}
+
+#endif
+
+/*
+ * Pick the fastest dot product this CPU can run
+ */
+static void select_kernel()
+{
+    unsigned int cpu = cpu_features();
+
+    fir_kernel = fir_scalar;
+    fir_kernel_name = "scalar";
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu & CPU_AVX2)
+    {
+        fir_kernel = fir_avx2;
+        fir_kernel_name = "avx2";
+    }
+    else if (cpu & CPU_SSE2)
+    {
+        fir_kernel = fir_sse2;
+        fir_kernel_name = "sse2";
+    }
+#elif defined(__ARM_NEON)
+    if (cpu & CPU_NEON)
+    {
+        fir_kernel = fir_neon;
+        fir_kernel_name = "neon";
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+const char *rrc_fir_kernel_name()
+{
+    return fir_kernel_name;
+}
+
+void rrc_fir_init(struct rrc_fir_s *filter)
+{
+    memset(filter, 0, sizeof(struct rrc_fir_s));
+}
+
 /*
  * FIR Filter with specified impulse length
+ *
+ * The index walks backwards through the history, so
+ * history[index] is the newest sample and
+ * history[index + NTAPS - 1] is the oldest.
  */
-void rrc_fir(complex float memory[], complex float sample[], int length)
+void rrc_fir(struct rrc_fir_s *filter, complex float sample[], int length)
+{
+    for (int j = 0; j < length; j++)
+    {
+        filter->index = (filter->index == 0) ? (NTAPS - 1) : (filter->index - 1);
+
+        filter->history[filter->index] = sample[j];
+        filter->history[filter->index + NTAPS] = sample[j];
+
+        sample[j] = fir_kernel(&filter->history[filter->index], rtaps, NTAPS_PADDED) * GAIN;
+    }
+}
+
+/*
+ * The original filter, which shifts the whole history one
+ * sample for every input. Kept as a reference for -Brrc.
+ *
+ * memory holds NTAPS samples, oldest first.
+ */
+void rrc_fir_shift(complex float memory[], complex float sample[], int length)
 {
     for (int j = 0; j < length; j++)
     {
@@ -39,6 +243,116 @@ void rrc_fir(complex float memory[], complex float sample[], int length)
     }
 }
 
+/*
+ * Add a sample to the filter history without filtering
+ */
+void rrc_fir_push(struct rrc_fir_s *filter, complex float sample)
+{
+    filter->index = (filter->index == 0) ? (NTAPS - 1) : (filter->index - 1);
+
+    filter->history[filter->index] = sample;
+    filter->history[filter->index + NTAPS] = sample;
+}
+
+/*
+ * Filter output mu (0 to 1) samples after the newest input
+ *
+ * mu = 0 is the same as rrc_fir() would give. Past the
+ * newest sample only the outermost tap is missing.
+ */
+complex float rrc_fir_frac(struct rrc_fir_s *filter, float mu)
+{
+    int p = (int)((mu * FRAC_PHASES) + 0.5f);
+
+    if (p < 0)
+        p = 0;
+    else if (p > FRAC_PHASES)
+        p = FRAC_PHASES;
+
+    return fir_kernel(&filter->history[filter->index], ftaps[p], NTAPS_PADDED) * GAIN;
+}
+
+/*
+ * Root raised cosine impulse at t samples from the center
+ */
+static double rrc_value(double t, double spb, double alpha)
+{
+    double u = t / spb;
+    double x = 4.0 * alpha * u;
+
+    if (fabs(u) < 1e-9)
+        return 1.0 - alpha + (4.0 * alpha / M_PI);
+
+    if (fabs(fabs(x) - 1.0) < 1e-9)
+        return (alpha / sqrt(2.0)) * ((1.0 + 2.0 / M_PI) * sin(M_PI / (4.0 * alpha)) +
+                                      (1.0 - 2.0 / M_PI) * cos(M_PI / (4.0 * alpha)));
+
+    return (sin(M_PI * u * (1.0 - alpha)) + x * cos(M_PI * u * (1.0 + alpha))) /
+           (M_PI * u * (1.0 - x * x));
+}
+
+/*
+ * Sample the impulse between the taps for the receive bank,
+ * keeping the same span and DC gain as the integer taps
+ */
+static void make_frac_taps(float spb, float alpha)
+{
+    double scale = 0.0;
+
+    for (int i = 0; i < NTAPS; i++)
+    {
+        scale += rrc_value(i - NTAPS / 2, spb, alpha);
+    }
+
+    memset(ftaps, 0, sizeof(ftaps));
+
+    for (int p = 0; p <= FRAC_PHASES; p++)
+    {
+        double mu = (double)p / FRAC_PHASES;
+
+        for (int i = 0; i < NTAPS_PADDED; i++)
+        {
+            /*
+             * Input i samples old, seen from mu
+             * past the newest, and its tap position
+             */
+            double t = (NTAPS / 2) - i - mu;
+
+            if (fabs(t) > (NTAPS / 2) + 1e-6)
+                continue;
+
+            float tap = (float)((rrc_value(t, spb, alpha) * GAIN) / scale);
+
+            ftaps[p][2 * i] = tap;
+            ftaps[p][(2 * i) + 1] = tap;
+        }
+    }
+}
+
+void rrc_interp_init(struct rrc_interp_s *interp)
+{
+    memset(interp, 0, sizeof(struct rrc_interp_s));
+}
+
+/*
+ * Upsample one symbol by CYCLES
+ *
+ * Gives the same result as zero-insertion followed
+ * by rrc_fir(), without the multiplies by zero.
+ */
+void rrc_interpolate(struct rrc_interp_s *interp, complex float symbol, complex float out[])
+{
+    interp->index = (interp->index == 0) ? (PHASE_TAPS - 1) : (interp->index - 1);
+
+    interp->history[interp->index] = symbol;
+    interp->history[interp->index + PHASE_TAPS] = symbol;
+
+    for (int p = 0; p < CYCLES; p++)
+    {
+        out[p] = fir_kernel(&interp->history[interp->index], ptaps[p], PHASE_TAPS) * GAIN;
+    }
+}
+
 void rrc_make(float fs, float rs, float alpha)
 {
     float num, den;
@@ -90,4 +404,27 @@ void rrc_make(float fs, float rs, float alpha)
     {
         coeffs[i] = (coeffs[i] * GAIN) / scale;
     }
+
+    memset(rtaps, 0, sizeof(rtaps));
+
+    for (int i = 0; i < NTAPS; i++)
+    {
+        rtaps[2 * i] = coeffs[(NTAPS - 1) - i];
+        rtaps[(2 * i) + 1] = coeffs[(NTAPS - 1) - i];
+    }
+
+    memset(ptaps, 0, sizeof(ptaps));
+
+    for (int p = 0; p < CYCLES; p++)
+    {
+        for (int k = 0; (p + k * CYCLES) < NTAPS; k++)
+        {
+            ptaps[p][2 * k] = coeffs[(NTAPS - 1) - (p + k * CYCLES)];
+            ptaps[p][(2 * k) + 1] = coeffs[(NTAPS - 1) - (p + k * CYCLES)];
+        }
+    }
+
+    make_frac_taps(spb, alpha);
+
+    select_kernel();
 }
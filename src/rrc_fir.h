@@ -17,11 +17,59 @@ extern "C"
 
 #include <complex.h>
 
+#include "ipnode.h"
+
 #define NTAPS 127 // lower bauds need more taps
+#define NTAPS_PADDED ((NTAPS + 3) & ~3) // vector kernels work 4 taps at a time
 #define GAIN 1.85
 
-    void rrc_fir(complex float *, complex float *, int);
+/*
+ * Each of the CYCLES interpolator branches
+ * gets every CYCLES'th tap, padded for the kernels
+ */
+#define PHASE_TAPS ((((NTAPS + CYCLES - 1) / CYCLES) + 3) & ~3)
+
+/*
+ * Fractional sample steps in the receive filter bank,
+ * the timing is rounded to 1 / (2 * FRAC_PHASES) sample
+ */
+#define FRAC_PHASES 32
+
+    /*
+     * Filter state, one per direction (rx/tx)
+     *
+     * The history is twice the filter length, and each
+     * sample is written to both halves, so the newest
+     * NTAPS samples are always contiguous. No shifting.
+     * The vector kernels read up to NTAPS_PADDED samples.
+     */
+    struct rrc_fir_s
+    {
+        complex float history[NTAPS + NTAPS_PADDED];
+        int index;
+    };
+
+    /*
+     * Polyphase interpolator state (transmit)
+     *
+     * Same doubled history as above, but holding
+     * symbols at the 1200 Baud rate.
+     */
+    struct rrc_interp_s
+    {
+        complex float history[2 * PHASE_TAPS];
+        int index;
+    };
+
+    void rrc_fir_init(struct rrc_fir_s *);
+    void rrc_fir(struct rrc_fir_s *, complex float *, int);
+    void rrc_fir_shift(complex float *, complex float *, int);
+    void rrc_fir_push(struct rrc_fir_s *, complex float);
+    complex float rrc_fir_frac(struct rrc_fir_s *, float);
+    void rrc_interp_init(struct rrc_interp_s *);
+    void rrc_interpolate(struct rrc_interp_s *, complex float, complex float *);
     void rrc_make(float, float, float);
+    const char *rrc_fir_kernel_name(void);
 
 #ifdef __cplusplus
 }
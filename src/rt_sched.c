@@ -0,0 +1,131 @@
+/*
+ * rt_sched.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "audio.h"
+#include "rt_sched.h"
+
+static struct sched_s save_sched[NUM_THTYPES];
+
+static const char *thname[NUM_THTYPES] = {"rx", "capture", "tx", "kiss", "link"};
+
+/*
+ * Called once from main after the config file is read,
+ * and before any threads are created.
+ *
+ * Realtime policies and mlockall need CAP_SYS_NICE / CAP_IPC_LOCK,
+ * or rtprio and memlock limits in /etc/security/limits.conf
+ */
+void rt_sched_init(struct audio_s *pa)
+{
+    memcpy(save_sched, pa->sched, sizeof(save_sched));
+
+    /*
+     * Unless told otherwise, run capture just above the
+     * DSP thread, so it can always empty the soundcard.
+     */
+    struct sched_s *cap = &save_sched[THTYPE_CAPTURE];
+    struct sched_s *rx = &save_sched[THTYPE_RX];
+
+    if (cap->policy == SCHED_OTHER && rx->policy != SCHED_OTHER)
+    {
+        cap->policy = rx->policy;
+        cap->priority = rx->priority + 1;
+    }
+
+    if (cap->cpu < 0)
+    {
+        cap->cpu = rx->cpu;
+    }
+
+    if (pa->mlockall == true)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            fprintf(stderr, "Warning: mlockall failed: %s. Check the memlock limit.\n", strerror(errno));
+        }
+    }
+}
+
+/*
+ * Apply the configured policy, priority and CPU
+ * to the calling thread.
+ *
+ * Failures are reported, but not fatal. The
+ * thread carries on with what it was given.
+ */
+void rt_sched_thread(int thtype)
+{
+    char name[16];
+
+    if (thtype < 0 || thtype >= NUM_THTYPES)
+    {
+        return;
+    }
+
+    struct sched_s *ps = &save_sched[thtype];
+
+    snprintf(name, sizeof(name), "ipnode-%s", thname[thtype]);
+    pthread_setname_np(pthread_self(), name);
+
+    if (ps->cpu >= 0)
+    {
+        cpu_set_t set;
+
+        if (ps->cpu >= sysconf(_SC_NPROCESSORS_CONF) || ps->cpu >= CPU_SETSIZE)
+        {
+            fprintf(stderr, "Warning: No CPU %d for %s thread\n", ps->cpu, thname[thtype]);
+        }
+        else
+        {
+            CPU_ZERO(&set);
+            CPU_SET(ps->cpu, &set);
+
+            int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+            if (e != 0)
+            {
+                fprintf(stderr, "Warning: Could not pin %s thread to CPU %d: %s\n",
+                        thname[thtype], ps->cpu, strerror(e));
+            }
+        }
+    }
+
+    if (ps->policy != SCHED_OTHER)
+    {
+        struct sched_param param;
+
+        int lo = sched_get_priority_min(ps->policy);
+        int hi = sched_get_priority_max(ps->policy);
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = (ps->priority < lo) ? lo : (ps->priority > hi) ? hi : ps->priority;
+
+        int e = pthread_setschedparam(pthread_self(), ps->policy, &param);
+
+        if (e != 0)
+        {
+            fprintf(stderr, "Warning: Could not set %s %d for %s thread: %s\n",
+                    (ps->policy == SCHED_FIFO) ? "FIFO" : "RR",
+                    param.sched_priority, thname[thtype], strerror(e));
+        }
+    }
+}
@@ -0,0 +1,25 @@
+/*
+ * rt_sched.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "audio.h"
+
+    void rt_sched_init(struct audio_s *);
+    void rt_sched_thread(int);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,192 @@
+/*
+ * sample_ring.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+
+#include "sample_ring.h"
+
+/*
+ * Create a ring holding at least size samples
+ *
+ * A live soundcard can't be held off, so normally a full
+ * ring drops the block. File input sets blocking, and the
+ * producer then waits for the consumer instead.
+ */
+bool sample_ring_init(struct sample_ring_s *ring, unsigned int size, bool blocking)
+{
+    unsigned int n = 1U;
+
+    while (n < size)
+    {
+        n <<= 1;
+    }
+
+    ring->buffer = (float *)calloc(n, sizeof(float));
+
+    if (ring->buffer == NULL)
+    {
+        fprintf(stderr, "sample_ring_init: Out of memory for %u samples\n", n);
+        return false;
+    }
+
+    ring->size = n;
+    ring->mask = n - 1U;
+    ring->blocking = blocking;
+
+    atomic_init(&ring->head, 0U);
+    atomic_init(&ring->tail, 0U);
+    atomic_init(&ring->overflows, 0UL);
+    atomic_init(&ring->dropped, 0UL);
+    atomic_init(&ring->high_water, 0U);
+    atomic_init(&ring->closed, false);
+
+    if (sem_init(&ring->data_ready, 0, 0) != 0 || sem_init(&ring->space_ready, 0, 0) != 0)
+    {
+        free(ring->buffer);
+        ring->buffer = NULL;
+
+        fprintf(stderr, "sample_ring_init: Could not create semaphore\n");
+        return false;
+    }
+
+    return true;
+}
+
+void sample_ring_free(struct sample_ring_s *ring)
+{
+    sem_destroy(&ring->data_ready);
+    sem_destroy(&ring->space_ready);
+    free(ring->buffer);
+
+    ring->buffer = NULL;
+}
+
+/*
+ * Fill level in samples
+ */
+unsigned int sample_ring_level(struct sample_ring_s *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire) -
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+/*
+ * Producer side, never blocks unless the ring is blocking
+ *
+ * If the whole block doesn't fit it is dropped
+ * and counted, and false is returned.
+ */
+bool sample_ring_write(struct sample_ring_s *ring, const float *samples, unsigned int count)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int level = head - tail;
+
+    while (ring->blocking == true && (ring->size - level) < count && count <= ring->size)
+    {
+        sem_wait(&ring->space_ready);
+
+        tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        level = head - tail;
+    }
+
+    if ((ring->size - level) < count)
+    {
+        atomic_fetch_add_explicit(&ring->overflows, 1UL, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->dropped, (unsigned long)count, memory_order_relaxed);
+        return false;
+    }
+
+    unsigned int index = head & ring->mask;
+    unsigned int first = ring->size - index; // room before the wrap
+
+    if (first > count)
+    {
+        first = count;
+    }
+
+    memcpy(&ring->buffer[index], samples, first * sizeof(float));
+    memcpy(&ring->buffer[0], &samples[first], (count - first) * sizeof(float));
+
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+
+    if ((level + count) > atomic_load_explicit(&ring->high_water, memory_order_relaxed))
+    {
+        atomic_store_explicit(&ring->high_water, level + count, memory_order_relaxed);
+    }
+
+    sem_post(&ring->data_ready);
+
+    return true;
+}
+
+/*
+ * Producer is done, wake the consumer so it can drain
+ */
+void sample_ring_close(struct sample_ring_s *ring)
+{
+    atomic_store_explicit(&ring->closed, true, memory_order_release);
+    sem_post(&ring->data_ready);
+}
+
+/*
+ * Consumer side, waits until count samples are there
+ *
+ * Returns false once the ring is closed and
+ * fewer than count samples are left.
+ */
+bool sample_ring_read(struct sample_ring_s *ring, float *samples, unsigned int count)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    while ((atomic_load_explicit(&ring->head, memory_order_acquire) - tail) < count)
+    {
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire) == true)
+        {
+            /*
+             * Check again, the last block may have
+             * landed just before the close
+             */
+            if ((atomic_load_explicit(&ring->head, memory_order_acquire) - tail) >= count)
+            {
+                break;
+            }
+
+            return false;
+        }
+
+        sem_wait(&ring->data_ready);
+    }
+
+    unsigned int index = tail & ring->mask;
+    unsigned int first = ring->size - index;
+
+    if (first > count)
+    {
+        first = count;
+    }
+
+    memcpy(samples, &ring->buffer[index], first * sizeof(float));
+    memcpy(&samples[first], &ring->buffer[0], (count - first) * sizeof(float));
+
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+
+    if (ring->blocking == true)
+    {
+        sem_post(&ring->space_ready);
+    }
+
+    return true;
+}
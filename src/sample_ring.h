@@ -0,0 +1,53 @@
+/*
+ * sample_ring.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+
+    /*
+     * Single producer, single consumer ring of samples
+     *
+     * The indexes run free and are masked on use,
+     * so head - tail is always the fill level.
+     */
+    struct sample_ring_s
+    {
+        float *buffer;
+        unsigned int size; // power of 2
+        unsigned int mask;
+        atomic_uint head;  // written by producer only
+        atomic_uint tail;  // written by consumer only
+        atomic_ulong overflows; // blocks dropped because the ring was full
+        atomic_ulong dropped;   // samples in those blocks
+        atomic_uint high_water; // most samples ever waiting
+        atomic_bool closed;     // producer has no more samples
+        bool blocking;          // producer waits for space rather than dropping
+        sem_t data_ready;
+        sem_t space_ready;
+    };
+
+    bool sample_ring_init(struct sample_ring_s *, unsigned int, bool);
+    void sample_ring_free(struct sample_ring_s *);
+    bool sample_ring_write(struct sample_ring_s *, const float *, unsigned int);
+    bool sample_ring_read(struct sample_ring_s *, float *, unsigned int);
+    void sample_ring_close(struct sample_ring_s *);
+    unsigned int sample_ring_level(struct sample_ring_s *);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,235 @@
+/*
+ * symbol_sync.c
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Closed loop symbol timing recovery
+ *
+ * The matched filter output is computed at two points per
+ * symbol, the on-time sample and the midpoint between symbols.
+ * The Gardner error from ted.c drives a proportional plus
+ * integral loop filter, which stretches or shrinks the time to
+ * the next interpolant. When the loop has walked a whole sample
+ * a block returns one symbol more or less than usual.
+ *
+ * Filtering, interpolation and decimation are one step. The
+ * baseband input only goes into the filter history, and at
+ * each TED instant the filter bank phase nearest the fraction
+ * is run once. That is two filter outputs per symbol rather
+ * than CYCLES.
+ */
+
+#include <stdbool.h>
+#include <complex.h>
+#include <math.h>
+
+#include "ipnode.h"
+#include "symbol_sync.h"
+#include "ted.h"
+#include "rrc_fir.h"
+#include "dcd.h"
+
+static void update_gains(void);
+
+static struct rrc_fir_s d_filter;
+
+static float d_sps;
+static float d_period;      // current samples per symbol
+static float d_max_dev;
+static float d_t;           // samples from the newest input to the next interpolant
+static float d_mu;
+static float d_integ;
+static float d_power;       // on-time sample power, for TED normalizing
+static complex float d_last; // previous on-time sample
+
+static float d_damping;
+static float d_loop_bw;
+static float d_alpha;
+static float d_beta;
+
+static bool d_ontime;
+static bool d_carrier;      // DCD as of the last symbol
+static int d_settle;        // transitions left before the integrator runs
+
+/*
+ * sps is the nominal samples per symbol, loop_bw the normalized
+ * loop bandwidth per symbol, and max_dev the most samples per
+ * symbol the period may be pulled away from nominal.
+ */
+void create_symbol_sync(float sps, float loop_bw, float damping, float max_dev)
+{
+    d_sps = sps;
+    d_max_dev = max_dev;
+    d_damping = damping;
+    d_loop_bw = loop_bw;
+
+    update_gains();
+    symbol_sync_reset();
+}
+
+void symbol_sync_reset()
+{
+    rrc_fir_init(&d_filter);
+
+    d_period = d_sps;
+    d_t = 0.0f;
+    d_mu = 0.0f;
+    d_integ = 0.0f;
+    d_power = 0.0f;
+    d_last = 0.0f;
+    d_ontime = true;
+    d_carrier = false;
+    d_settle = SYMSYNC_SETTLE;
+
+    /*
+     * Next TED input is the on-time sample
+     */
+    sync_reset_input_clock();
+}
+
+/*
+ * Second order loop, the error is normalized to signal
+ * power so the gains hold whatever the audio level.
+ * With the .35 RRC the normalized Gardner slope
+ * measures about .75 per symbol of offset.
+ */
+static void update_gains()
+{
+    float denom = ((1.0f + (2.0f * d_damping * d_loop_bw)) + (d_loop_bw * d_loop_bw));
+    float kd = 0.75f / d_sps; // error per sample of offset
+
+    d_alpha = ((4.0f * d_damping * d_loop_bw) / denom) / kd;
+    d_beta = ((4.0f * d_loop_bw * d_loop_bw) / denom) / kd;
+}
+
+static void loop_update(complex float sample)
+{
+    float p = crealf(sample) * crealf(sample) + cimagf(sample) * cimagf(sample);
+
+    d_power = (d_power == 0.0f) ? p : d_power + 0.01f * (p - d_power);
+
+    if (get_dcd() != d_carrier)
+    {
+        d_carrier = get_dcd();
+
+        if (d_carrier == true)
+        {
+            d_integ = 0.0f; // new burst, DCD hang time may have walked it
+            d_settle = SYMSYNC_SETTLE;
+        }
+    }
+
+    /*
+     * The Gardner error only means something across a
+     * symbol transition, a quarter turn moves the on-time
+     * point by twice the power. The unmodulated preamble
+     * has none, and gives noise only.
+     */
+    complex float step = sample - d_last;
+    bool transition = (crealf(step) * crealf(step) + cimagf(step) * cimagf(step)) > d_power;
+
+    d_last = sample;
+
+    if (d_power < 1e-12f || transition == false)
+    {
+        d_period = d_sps + d_integ;
+        return;
+    }
+
+    float error = get_error() / d_power;
+
+    /*
+     * Keep the filter ramp-up at the start of
+     * a burst from winding up the integrator
+     */
+    if (error > 1.0f)
+        error = 1.0f;
+    else if (error < -1.0f)
+        error = -1.0f;
+
+    /*
+     * The integrator holds the clock error, and is only
+     * moved with a carrier present. In the noise between
+     * bursts the normalized error is as big as it gets,
+     * and would walk the clock off to the limit.
+     */
+    if (d_carrier == true && d_settle > 0)
+    {
+        d_settle--;
+    }
+    else if (d_carrier == true)
+    {
+        d_integ += d_beta * error;
+
+        if (d_integ > d_max_dev)
+            d_integ = d_max_dev;
+        else if (d_integ < -d_max_dev)
+            d_integ = -d_max_dev;
+    }
+
+    /*
+     * A late sample gives a negative error,
+     * so the next symbol comes sooner.
+     *
+     * Only the integrator, the clock rate, is held to
+     * max_dev. The proportional term moves the phase,
+     * and capping it too would slow the pull-in.
+     */
+    d_period = d_sps + d_integ + d_alpha * error;
+}
+
+/*
+ * Process count baseband samples, before the matched filter
+ *
+ * The filtered on-time symbols go to out[], normally
+ * count / sps of them. Returns how many.
+ */
+int symbol_sync(complex float in[], int count, complex float out[])
+{
+    int n = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        rrc_fir_push(&d_filter, in[i]);
+
+        d_t -= 1.0f;
+
+        while (d_t < 1.0f)
+        {
+            d_mu = (d_t < 0.0f) ? 0.0f : d_t;
+
+            complex float y = rrc_fir_frac(&d_filter, d_mu);
+
+            ted_input(y);
+
+            if (d_ontime == true)
+            {
+                loop_update(y);
+
+                if (n < SYMSYNC_MAX_OUT)
+                    out[n++] = y;
+            }
+
+            d_ontime = !d_ontime;
+            d_t += d_period / 2.0f;
+        }
+    }
+
+    return n;
+}
+
+float get_symbol_period()
+{
+    return d_period;
+}
+
+float get_symbol_mu()
+{
+    return d_mu;
+}
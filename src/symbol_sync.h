@@ -0,0 +1,47 @@
+/*
+ * symbol_sync.h
+ *
+ * IP Node Project
+ *
+ * Fork by Steve Sampson, K5OKC, May 2024
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <complex.h>
+
+/*
+ * Most symbols one call can return, the loop
+ * can't stretch far enough to need more
+ */
+#define SYMSYNC_MAX_OUT 4
+
+/*
+ * Heavily damped, so the phase pulls in as fast as a
+ * 0.01 loop at 0.707 would, but the clock integrator
+ * moves 30 times slower and holds a steady rate
+ */
+#define SYMSYNC_LOOP_BW 0.0018f // normalized to the symbol rate
+#define SYMSYNC_DAMPING 3.9f
+#define SYMSYNC_SETTLE 32       // transitions at a burst start the phase pulls in on alone
+#define SYMSYNC_MAX_DEV 0.004f  // samples per symbol, about 500 ppm
+
+void create_symbol_sync(float, float, float, float);
+void symbol_sync_reset(void);
+int symbol_sync(complex float[], int, complex float[]);
+
+// Getters
+
+float get_symbol_period(void);
+float get_symbol_mu(void);
+
+#ifdef __cplusplus
+}
+#endif
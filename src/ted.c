@@ -15,7 +15,6 @@
 #include <stdbool.h>
 #include <math.h>
 
-#include "deque.h"
 #include "ted.h"
 
 // BSS Storage
@@ -26,13 +25,19 @@ static float d_prev_error;
 static int d_inputs_per_symbol;
 static int d_input_clock;
 
-static deque *d_input;
+/*
+ * The last TED_HISTORY inputs by value, d_head is the
+ * newest. Only three are used (previous, middle, current).
+ */
+static complex float d_input[TED_HISTORY];
+static unsigned int d_head;
 
 // Prototypes
 
 static float compute_error(void);
 static void advance_input_clock(void);
 static float enormalize(float, float);
+static void clear_input(void);
 
 // Functions
 
@@ -65,6 +70,25 @@ static void advance_input_clock()
     d_input_clock = (d_input_clock + 1) % d_inputs_per_symbol;
 }
 
+/*
+ * Zero values for previous, middle and current
+ */
+static void clear_input()
+{
+    for (int i = 0; i < TED_HISTORY; i++)
+        d_input[i] = 0.0f;
+
+    d_head = 0;
+}
+
+/*
+ * Input n steps back, 0 is the newest
+ */
+static inline complex float input_at(unsigned int n)
+{
+    return d_input[(d_head - n) & (TED_HISTORY - 1)];
+}
+
 /*
  * Reset the timing error detector
  */
@@ -73,12 +97,7 @@ void sync_reset()
     d_error = 0.0f;
     d_prev_error = 0.0f;
 
-    empty_deque(d_input);
-
-    // push 3 zero values (previous, current, middle)
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
+    clear_input();
     sync_reset_input_clock();
 }
 
@@ -88,30 +107,19 @@ void create_timing_error_detector()
     d_prev_error = 0.0f;
     d_inputs_per_symbol = 2; // The input samples per symbol required
 
-    d_input = create_deque();
-
-    // push 3 zero values (previous, current, middle)
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
-    push_front(d_input, (complex float *) calloc(1, sizeof (complex float)));
-    
+    clear_input();
     sync_reset_input_clock();
 }
 
-void destroy_timing_error_detector()
-{
-    free(d_input);
-}
-
 /*
  * Provide a complex input sample to the TED algorithm
  *
- * @param x is pointer to the input sample
+ * @param x is the input sample, it is copied
  */
-void ted_input(complex float *x)
+void ted_input(complex float x)
 {
-    push_front(d_input, x);
-    pop_back(d_input); // throw away
+    d_head = (d_head + 1) & (TED_HISTORY - 1);
+    d_input[d_head] = x;
 
     advance_input_clock();
 
@@ -134,8 +142,14 @@ void revert(bool preserve_error)
 
     revert_input_clock();
 
-    push_back(d_input, back(d_input));
-    pop_front(d_input);  // throw away
+    /*
+     * Drop the newest, and repeat the oldest
+     * to fill in the far end of the history
+     */
+    complex float oldest = input_at(2);
+
+    d_head = (d_head - 1) & (TED_HISTORY - 1);
+    d_input[(d_head - 2) & (TED_HISTORY - 1)] = oldest;
 }
 
 /*
@@ -169,9 +183,9 @@ static float enormalize(float error, float maximum)
  */
 static float compute_error()
 {
-    complex float current =   *((complex float *)get(d_input, 0));
-    complex float middle =    *((complex float *)get(d_input, 1));
-    complex float previous =  *((complex float *)get(d_input, 2));
+    complex float current = input_at(0);
+    complex float middle = input_at(1);
+    complex float previous = input_at(2);
 
     float errorInphase = (crealf(previous) - crealf(current)) * crealf(middle);
     float errorQuadrature = (cimagf(previous) - cimagf(current)) * cimagf(middle);
@@ -181,7 +195,7 @@ static float compute_error()
 
 complex float getMiddleSample()
 {
-    return *((complex float *)get(d_input, 1));
+    return input_at(1);
 }
 
 /*
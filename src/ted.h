@@ -18,12 +18,13 @@ extern "C"
 #include <complex.h>
 #include <stdbool.h>
 
+#define TED_HISTORY 4 // power of two, at least 3
+
 void revert_input_clock(void);
 void sync_reset_input_clock(void);
 void sync_reset(void);
 void create_timing_error_detector(void);
-void destroy_timing_error_detector(void);
-void ted_input(complex float *);
+void ted_input(complex float);
 void revert(bool);
 complex float getMiddleSample(void);
 float get_error(void);
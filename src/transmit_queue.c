@@ -21,6 +21,7 @@
 #include "ax25_pad.h"
 #include "audio.h"
 #include "transmit_queue.h"
+#include "transmit_thread.h"
 
 static packet_t queue_head[TQ_NUM_PRIO]; /* Head of linked list for each queue. */
 
@@ -115,6 +116,8 @@ void transmit_queue_append(int prio, packet_t pp)
 
         il2p_mutex_unlock(&wake_up_mutex);
     }
+
+    tx_wakeup(); // in case it is waiting for the channel
 }
 
 /*
@@ -220,6 +223,8 @@ void lm_seize_request()
 
         il2p_mutex_unlock(&(wake_up_mutex));
     }
+
+    tx_wakeup();
 }
 
 /*
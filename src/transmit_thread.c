@@ -21,6 +21,10 @@
 #include <errno.h>
 #include <stddef.h>
 #include <complex.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #include "ipnode.h"
 #include "ax25_link.h"
@@ -33,7 +37,9 @@
 #include "receive_queue.h"
 #include "receive_thread.h"
 #include "rrc_fir.h"
+#include "nco.h"
 #include "constellation.h"
+#include "rt_sched.h"
 
 extern bool node_shutdown;
 
@@ -45,28 +51,56 @@ static int tx_txtail;
 static bool tx_fulldup;
 
 #define WAIT_TIMEOUT_MS (60 * 1000)
-#define WAIT_CHECK_EVERY_MS 10
 #define BITS_TO_MS(b) (((b)*875) / tx_baud)
 #define MS_TO_BITS(ms) (((ms)*tx_baud) / 875) // 100 ms == 137 bits
 
+/*
+ * Symbols are modulated and sent to the soundcard
+ * this many at a time, so memory use does not grow
+ * with the frame length.
+ */
+#define TX_CHUNK_SYMBOLS 32
+
 static void *tx_thread(void *);
 static bool wait_for_clear_channel(int, int, bool);
 static void tx_frames(int, packet_t);
 static int send_one_frame(packet_t);
 static void put_symbols(complex float[], int);
+static void put_symbol(complex float);
+
+/*
+ * Channel access sleeps in poll() on these. The event is
+ * written when DCD changes or a frame is queued, and the
+ * timer runs out the DWAIT and persistence slots.
+ */
+static int tx_event_fd = -1;
+static int tx_timer_fd = -1;
+
+enum wait_result
+{
+    WAIT_TIMER,
+    WAIT_BUSY,     // DCD came on
+    WAIT_PRIORITY  // a high priority frame is waiting
+};
 
 static pthread_t tx_tid;
 static pthread_mutex_t audio_out_dev_mutex;
 static struct audio_s *save_audio_config_p;
 
-static complex float tx_filter[NTAPS];
+static struct rrc_interp_s tx_interp;
 
-static complex float m_txPhase;
-static complex float m_txRect;
+static struct nco_s tx_nco;
 static complex float *m_qpsk;
 
+static complex float tx_symbols[TX_CHUNK_SYMBOLS];
+static complex float tx_signal[CYCLES * TX_CHUNK_SYMBOLS];
+static float tx_pcm[CYCLES * TX_CHUNK_SYMBOLS];
+static int tx_symbol_count;
+
 static void *tx_thread(void *arg)
 {
+    rt_sched_thread(THTYPE_TX);
+
     while (node_shutdown == false)
     {
 
@@ -121,6 +155,17 @@ void tx_init(struct audio_s *p_modem)
 
     il2p_mutex_init(&audio_out_dev_mutex);
 
+    tx_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    tx_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (tx_event_fd < 0 || tx_timer_fd < 0)
+    {
+        fprintf(stderr, "tx_init: Could not create channel access event or timer\n");
+        exit(1);
+    }
+
+    tx_reset();
+
     int e = pthread_create(&tx_tid, NULL, tx_thread, (void *)NULL);
 
     if (e != 0)
@@ -128,13 +173,22 @@ void tx_init(struct audio_s *p_modem)
         fprintf(stderr, "tx_init: Could not create transmitter thread for modem\n");
         exit(1);
     }
+}
+
+/*
+ * Modulator back to its startup state
+ */
+void tx_reset()
+{
+    rrc_interp_init(&tx_interp);
 
     // Passband Center Frequency is 1000 Hz
 
-    m_txRect = cmplx((TAU * CENTER) / FS);
-    m_txPhase = cmplx(0.0f);
+    nco_init(&tx_nco, CENTER, FS);
 
     m_qpsk = getQPSKConstellation();
+
+    tx_symbol_count = 0;
 }
 
 #ifdef NOT_USED
@@ -167,105 +221,182 @@ static void put_symbols(complex float symbols[], int symbolsCount)
 {
     int outputSize = CYCLES * symbolsCount; // upsample 1200 to 9600
 
-    complex float signal[outputSize]; // transmit signal
+    complex float *signal = tx_signal; // transmit signal
 
     /*
-     * Use zero-insertion to change the
-     * sample rate from 1200 to 9600.
+     * Root Cosine Filter pulse baseband
+     *
+     * The polyphase interpolator changes the sample
+     * rate from 1200 to 9600 as it filters.
      */
     for (int i = 0; i < symbolsCount; i++)
     {
-        int index = (i * CYCLES); // compute once
-
-        signal[index] = symbols[i];
-
-        for (int j = 1; j < CYCLES; j++)
-        {
-            signal[index + j] = CMPLXF(0.0f, 0.0f);
-        }
+        rrc_interpolate(&tx_interp, symbols[i], &signal[i * CYCLES]);
     }
 
     /*
-     * Root Cosine Filter pulse baseband
+     * Shift filtered Baseband to Passband
+     * keeping the real part for the soundcard
      */
-    rrc_fir(tx_filter, signal, outputSize);
+    nco_mix_up(&tx_nco, signal, tx_pcm, outputSize);
 
     /*
-     * Shift filtered Baseband to Passband
+     * Saturated to 16-bit PCM in the output buffer
      */
-    for (int i = 0; i < outputSize; i++)
+    audio_write(tx_pcm, outputSize);
+}
+
+/*
+ * Queue one symbol, modulating a chunk when full
+ */
+static void put_symbol(complex float symbol)
+{
+    tx_symbols[tx_symbol_count++] = symbol;
+
+    if (tx_symbol_count == TX_CHUNK_SYMBOLS)
+    {
+        put_symbols(tx_symbols, tx_symbol_count);
+        tx_symbol_count = 0;
+    }
+}
+
+/*
+ * Transmit octets
+ *
+ * Bytes are sent MSB first, and become pulses to be
+ * filtered and modulated. Audio goes out in chunks of
+ * TX_CHUNK_SYMBOLS as the bytes are consumed.
+ */
+void tx_frame_bytes(int mode, uint8_t tx_bytes[], int num_bytes)
+{
+    for (int i = 0; i < num_bytes; i++)
     {
-        m_txPhase *= m_txRect;
-        signal[i] *= (m_txPhase * 32768.0f); // Factor PCM amplitude
+        uint8_t x = tx_bytes[i];
+
+        if (mode == Mode_QPSK)
+        {
+            for (int shift = 6; shift >= 0; shift -= 2) // 2-Bits per symbol
+            {
+                put_symbol(getQPSKQuadrant((x >> shift) & 0x3));
+            }
+        }
+        else if (mode == Mode_BPSK) // Mode_BPSK
+        {
+            for (int shift = 7; shift >= 0; shift--) // 1-Bit per symbol
+            {
+                put_symbol(getQPSKQuadrant(((x >> shift) & 0x1) ? 3 : 0));
+            }
+        }
+        else if (mode == Mode_SYNC) // Send FLAGS at 300 baud
+        {
+            for (int shift = 7; shift >= 0; shift--) // 1-Bit per symbol
+            {
+                put_symbol(getQPSKQuadrant(((x >> shift) & 0x1) ? 3 : 0) * .75f); // 75% amplitude
+            }
+        }
     }
 
     /*
-     * Store PCM audio (real part) in output buffer
+     * Send what is left over
      */
-    for (int i = 0; i < outputSize; i++)
+    if (tx_symbol_count > 0)
     {
-        short pcm = (short)(crealf(signal[i])); // (* 16k above)
-        audio_put(pcm & 0xff);                  // little-endian
-        audio_put((pcm >> 8) & 0xff);
+        put_symbols(tx_symbols, tx_symbol_count);
+        tx_symbol_count = 0;
     }
 }
 
 /*
- * Transmit octets
+ * Wake the transmit thread if it is waiting for the channel
  *
- * These are pulses to be filtered and modulated
+ * Called by the receiver when DCD changes, and by the
+ * transmit queue when a frame arrives. Safe to call
+ * before tx_init(), it does nothing then.
  */
-void tx_frame_bits(int mode, uint8_t tx_bits[], int num_bits)
+void tx_wakeup()
 {
-    int symbol_count = 0;
-    int bit_count = 0;
-    int save_bit;
-
-    if (mode == Mode_QPSK)
+    if (tx_event_fd >= 0)
     {
-        complex float tx_symbols[num_bits / 2]; // 2-Bits per symbol
+        uint64_t one = 1;
 
-        for (int i = 0; i < num_bits; i++)
+        if (write(tx_event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
         {
-            if (bit_count == 0) // wait for 2 bits
-            {
-                save_bit = tx_bits[i];
-                bit_count++;
+            fprintf(stderr, "tx_wakeup: %s\n", strerror(errno));
+        }
+    }
+}
 
-                continue;
-            }
+static long ms_since(const struct timespec *start)
+{
+    struct timespec now;
 
-            uint8_t dibit = ((save_bit << 1) | tx_bits[i]) & 0x3;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-            tx_symbols[symbol_count++] = getQPSKQuadrant(dibit);
+    return ((now.tv_sec - start->tv_sec) * 1000L) + ((now.tv_nsec - start->tv_nsec) / 1000000L);
+}
 
-            save_bit = 0; // reset for next bits
-            bit_count = 0;
-        }
+static void drain(int fd)
+{
+    uint64_t count;
 
-        put_symbols(tx_symbols, symbol_count);
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    {
+        fprintf(stderr, "drain: %s\n", strerror(errno));
     }
-    else if (mode == Mode_BPSK) // Mode_BPSK
+}
+
+/*
+ * Sleep for ms on the timer, returning early if DCD comes
+ * on, or if priority is set and a high priority frame is
+ * queued. Other wakeups just go back to sleep.
+ */
+static enum wait_result wait_event(int ms, bool priority)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = ((ms % 1000) * 1000000L) + 1; // never all zero, that disarms
+
+    drain(tx_timer_fd);
+    timerfd_settime(tx_timer_fd, 0, &its, NULL);
+
+    struct pollfd fds[2] = {
+        {.fd = tx_event_fd, .events = POLLIN},
+        {.fd = tx_timer_fd, .events = POLLIN}};
+
+    while (true)
     {
-        complex float tx_symbols[num_bits]; // 1-Bit per symbol
+        if (get_dcd_detect() == true)
+            return WAIT_BUSY;
 
-        for (int i = 0; i < num_bits; i++)
+        if (priority == true && transmit_queue_peek(TQ_PRIO_0_HI) != NULL)
+            return WAIT_PRIORITY;
+
+        if (poll(fds, 2, -1) < 0)
         {
-            tx_symbols[symbol_count++] = getQPSKQuadrant((tx_bits[i] == 0) ? 0 : 3);
+            if (errno == EINTR)
+                continue;
+
+            fprintf(stderr, "wait_event: poll %s\n", strerror(errno));
+            return WAIT_BUSY; // channel state unknown, don't key up
         }
 
-        put_symbols(tx_symbols, symbol_count);
-    }
-    else if (mode == Mode_SYNC) // Send FLAGS at 300 baud
-    {
-        complex float tx_symbols[num_bits]; // 1-Bit per symbol
+        if (fds[0].revents & POLLIN)
+            drain(tx_event_fd);
 
-        for (int i = 0; i < num_bits; i++)
+        if (fds[1].revents & POLLIN)
         {
-            tx_symbols[symbol_count++] = getQPSKQuadrant((tx_bits[i] == 0) ? 0 : 3) * .75f; // 75% amplitude
-        }
+            drain(tx_timer_fd);
 
-        put_symbols(tx_symbols, symbol_count);
+            /*
+             * The event may have come in with the timer
+             */
+            if (get_dcd_detect() == true)
+                return WAIT_BUSY;
+
+            return WAIT_TIMER;
+        }
     }
 }
 
@@ -273,68 +404,79 @@ void tx_frame_bits(int mode, uint8_t tx_bits[], int num_bits)
  * Check to see if we are receiving valid data
  * (DCD active) or if we are full duplex and
  * DCD doesn't matter
+ *
+ * Nothing is polled on a clock. The thread sleeps
+ * until DCD changes, a frame is queued, or a DWAIT
+ * or persistence slot ends on the timer.
  */
 static bool wait_for_clear_channel(int slottime, int persist, bool fulldup)
 {
-    int n = 0;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
     if (fulldup == false)
     {
 
     start_over_again:
 
-        while (get_dcd_detect() == true)
+        if (ms_since(&start) >= WAIT_TIMEOUT_MS)
         {
-            SLEEP_MS(WAIT_CHECK_EVERY_MS);
+            return false;
+        }
 
-            n++;
+        while (get_dcd_detect() == true)
+        {
+            long left = WAIT_TIMEOUT_MS - ms_since(&start);
 
-            if (n > (WAIT_TIMEOUT_MS / WAIT_CHECK_EVERY_MS))
+            if (left <= 0)
             {
                 return false;
             }
-        }
 
-        if (save_audio_config_p->dwait > 0)
-        {
-            SLEEP_MS(save_audio_config_p->dwait * 10);
+            struct pollfd efd = {.fd = tx_event_fd, .events = POLLIN};
+
+            if (poll(&efd, 1, (int)left) > 0)
+                drain(tx_event_fd);
         }
 
-        if (get_dcd_detect() == true)
+        if (save_audio_config_p->dwait > 0)
         {
-            goto start_over_again;
+            if (wait_event(save_audio_config_p->dwait * 10, false) == WAIT_BUSY)
+            {
+                goto start_over_again;
+            }
         }
 
         while (transmit_queue_peek(TQ_PRIO_0_HI) == NULL)
         {
-            SLEEP_MS(slottime * 10);
+            enum wait_result r = wait_event(slottime * 10, true);
 
-            if (get_dcd_detect() == true)
+            if (r == WAIT_BUSY)
             {
                 goto start_over_again;
             }
 
-            int r = rand() & 0xff;
-
-            if (r <= persist)
+            if (r == WAIT_PRIORITY)
             {
                 break;
             }
-        }
-    }
-
-    while (!il2p_mutex_try_lock(&audio_out_dev_mutex))
-    {
-        SLEEP_MS(WAIT_CHECK_EVERY_MS);
 
-        n++;
+            int rnd = rand() & 0xff;
 
-        if (n > (WAIT_TIMEOUT_MS / WAIT_CHECK_EVERY_MS))
-        {
-            return false;
+            if (rnd <= persist)
+            {
+                break;
+            }
         }
     }
 
+    /*
+     * Only this thread takes it, so there is no
+     * one to wait for
+     */
+    il2p_mutex_lock(&audio_out_dev_mutex);
+
     return true;
 }
 
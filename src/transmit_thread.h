@@ -24,7 +24,9 @@ extern "C"
 #include "audio.h"
 
     void tx_init(struct audio_s *);
-    void tx_frame_bits(int, uint8_t *, int);
+    void tx_reset(void);
+    void tx_frame_bytes(int, uint8_t *, int);
+    void tx_wakeup(void);
 
 #ifdef __cplusplus
 }